@@ -0,0 +1,216 @@
+#include <stdlib.h>
+#include <string.h>
+#if !defined(ROCC_EMU) && defined(__linux__)
+#include <setjmp.h>
+#include <signal.h>
+#endif
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "rocc.h"
+#include "acc_utils.h"
+#include "acc_model.h"
+#include "chain.h"
+#include "chain_impl.h"
+#include "chain_trace.h"
+
+int64_t mm_chain_fill_acc(const mm_chain_fill_t *fl, int64_t st, int64_t i0, int64_t i1, mm_chain_stats_t *cs)
+{
+    const mm128_t *a = fl->a;
+    int32_t *f = fl->f, *p = fl->p, *t = fl->t, *v = fl->v;
+    int max_dist_x = fl->max_dist_x, max_skip = fl->max_skip, max_iter = fl->max_iter;
+    int64_t i, j;
+    MM_CHAIN_STAT_COUNT;
+
+    // fill the score and backtrack arrays
+    for (i = i0; i < i1; ++i)
+    {
+        uint64_t ri = a[i].x;
+        int64_t max_j = -1;
+        int32_t qi = (int32_t)a[i].y, q_span = a[i].y >> 32 & 0xff; // NB: only 8 bits of span is used!!!
+        int32_t max_f = q_span, n_skip = 0, tag = fl->t_tag + (int32_t)i;
+        int32_t sidi = (a[i].y & MM_SEED_SEG_MASK) >> MM_SEED_SEG_SHIFT;
+
+        // Temporary array of setup values to pass onto accelerator
+        int64_t setup_array[7];
+        setup_array[0] = (int64_t)fl->is_cdna;
+        setup_array[1] = (int64_t)ri;
+        setup_array[2] = (int64_t)qi;
+        setup_array[3] = (int64_t)q_span;
+        setup_array[4] = (int64_t)sidi;
+        setup_array[5] = fl->q32_avg_qspan;
+        setup_array[6] = fl->q32_gap_scale;
+
+        // Load parameters into the accelerator
+        if (!fl->coj)
+            ROCC_LOAD_PARAMS((void *)setup_array);
+
+        while (st < i && ri > a[st].x + max_dist_x)
+            ++st;
+        if (i - st > max_iter)
+            st = i - max_iter;
+
+        for (j = i - 1; j >= st; --j)
+        {
+            MM_CHAIN_STAT_INC(n_pred);
+            int32_t sc = (int32_t)(fl->coj ? fl->coj(setup_array, a, j) : ROCC_COJ(j)); // the gap-penalised score in 64 bits, exact in 32 for sane inputs
+            MM_TRACE(MM_TRACE_COJ, i, j, 0, 0, sc, 0, sc + f[j] > max_f ? j : max_j);
+            sc += f[j];
+            if (sc > max_f)
+            {
+                max_f = sc, max_j = j;
+                if (n_skip > 0)
+                    --n_skip;
+            }
+            else if (t[j] == tag)
+            {
+                if (++n_skip > max_skip)
+                {
+                    MM_CHAIN_STAT_INC(n_skip_exit);
+                    break;
+                }
+            }
+            if (p[j] >= 0)
+                t[p[j]] = tag;
+        }
+        f[i] = max_f, p[i] = max_j;
+        MM_TRACE(MM_TRACE_ROW, i, -1, 0, 0, max_f, 0, max_j);
+        v[i] = max_j >= 0 && v[max_j] > max_f ? v[max_j] : max_f; // v[] keeps the peak score up to i; f[] is the score ending at i, not always the peak
+    }
+    MM_CHAIN_STAT_FLUSH(cs);
+    return st;
+}
+
+void mm_chain_fill_acc_init(mm_chain_fill_t *fl, mm_chain_coj_f coj, int max_dist_x, int max_skip, int max_iter, float gap_scale, int is_cdna,
+                            int64_t n, mm128_t *a, void *km, mm_chain_ws_t *ws)
+{
+    uint64_t sum_qspan;
+    memset(fl, 0, sizeof(*fl));
+    sum_qspan = mm_chain_dp_head(km, ws, n, a, &fl->f, &fl->p, &fl->t, &fl->v, &fl->t_tag);
+    if (!coj)
+        sum_qspan = ROCC_SUM_QSPAN(a, n);
+    // Q32.32 parameters from integers only, so the "fixed" software backend loads the same bits
+    fl->q32_avg_qspan = acc_q32_avg(sum_qspan, n);
+    fl->q32_gap_scale = acc_q32_from_float(gap_scale);
+    fl->max_dist_x = max_dist_x, fl->max_skip = max_skip, fl->max_iter = max_iter, fl->is_cdna = is_cdna, fl->a = a, fl->coj = coj;
+    MM_TRACE(MM_TRACE_CALL, n, -1, sum_qspan, 0, 0, 0, -1);
+}
+
+mm128_t *mm_chain_dp_acc_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws, mm_chain_stats_t *cs)
+{ // TODO: make sure this works when n has more than 32 bits
+    mm_chain_fill_t fl;
+    MM_CHAIN_STAT_TIMER;
+
+    (void)max_dist_y, (void)bw, (void)n_segs;
+    if (_u)
+        *_u = 0, *n_u_ = 0;
+    if (n == 0 || a == 0)
+    {
+        mm_chain_a_free(km, ws, a);
+        return 0;
+    }
+    mm_chain_fill_acc_init(&fl, 0, max_dist_x, max_skip, max_iter, gap_scale, is_cdna, n, a, km, ws);
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_QSPAN);
+    mm_chain_fill_acc(&fl, 0, 0, n, cs);
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_FILL);
+    return mm_chain_dp_tail(min_cnt, min_sc, n, a, fl.f, fl.p, fl.t, fl.v, fl.t_tag, n_u_, _u, km, ws, cs);
+}
+
+int mm_chain_screen_acc_st(int32_t min_hit, int k, int32_t *top, mm_chain_screen_t *r, int max_dist_x, int max_dist_y, int bw, int max_skip,
+                           int max_iter, int min_cnt, int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, void *km,
+                           mm_chain_ws_t *ws, mm_chain_stats_t *cs)
+{
+    mm_chain_fill_t fl;
+    MM_CHAIN_STAT_TIMER;
+
+    (void)max_dist_y, (void)bw, (void)n_segs;
+    memset(r, 0, sizeof(*r));
+    if (n == 0 || a == 0)
+    {
+        mm_chain_a_free(km, ws, a);
+        return 0;
+    }
+    mm_chain_fill_acc_init(&fl, 0, max_dist_x, max_skip, max_iter, gap_scale, is_cdna, n, a, km, ws);
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_QSPAN);
+    return mm_chain_screen_fill(mm_chain_fill_acc, &fl, min_hit, k, top, r, min_cnt, min_sc, n, a, km, ws, cs);
+}
+
+mm128_t *mm_chain_dp_acc(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km)
+{
+    return mm_chain_dp_acc_st(max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n_segs, n, a, n_u_, _u, km, 0, 0);
+}
+
+// Whether custom0 reaches the accelerator. MM_CHAIN_ACC=0 or 1 in the environment decides if set. Otherwise one QSPAN
+// over no anchors is issued with the illegal-instruction trap caught: as SIGILL under Linux, and on bare metal, which
+// runs in M-mode under libgloss-htif, through a handler swapped into mtvec with interrupts off. Probed once, on the
+// first call; mm_chain_batch() makes that before it starts workers. "acc" is by name only, so this decides whether
+// that name is honoured, not whether "auto" picks it.
+#ifndef ROCC_EMU
+static volatile int acc_probe_trapped;
+
+#if defined(__linux__)
+static sigjmp_buf acc_probe_jb;
+
+static void acc_probe_sigill(int sig)
+{
+    (void)sig;
+    acc_probe_trapped = 1;
+    siglongjmp(acc_probe_jb, 1);
+}
+
+static int acc_probe(void)
+{
+    struct sigaction sa, old;
+    mm128_t a0;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = acc_probe_sigill;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGILL, &sa, &old) != 0)
+        return 0;
+    if (sigsetjmp(acc_probe_jb, 1) == 0)
+        ROCC_SUM_QSPAN(&a0, 0);
+    sigaction(SIGILL, &old, 0);
+    return !acc_probe_trapped;
+}
+#elif defined(__riscv)
+// skips the faulting instruction; custom0 encodings are 4 bytes
+static void __attribute__((interrupt("machine"), aligned(4))) acc_probe_trap(void)
+{
+    uintptr_t epc;
+    asm volatile("csrr %0, mepc" : "=r"(epc));
+    asm volatile("csrw mepc, %0" ::"r"(epc + 4));
+    acc_probe_trapped = 1;
+}
+
+static int acc_probe(void)
+{
+    uintptr_t tvec, mie;
+    mm128_t a0;
+    asm volatile("csrrci %0, mstatus, 8" : "=r"(mie));
+    asm volatile("csrrw %0, mtvec, %1" : "=r"(tvec) : "r"((uintptr_t)acc_probe_trap));
+    ROCC_SUM_QSPAN(&a0, 0);
+    asm volatile("csrw mtvec, %0" ::"r"(tvec));
+    asm volatile("csrs mstatus, %0" ::"r"(mie & 8));
+    return !acc_probe_trapped;
+}
+#else
+static int acc_probe(void)
+{
+    return 0;
+}
+#endif
+#endif
+
+int mm_chain_acc_avail(void)
+{
+#ifdef ROCC_EMU
+    return 1;
+#else
+    static int present = -1;
+    if (present < 0)
+    {
+        const char *e = getenv("MM_CHAIN_ACC");
+        present = e && *e ? atoi(e) != 0 : acc_probe();
+    }
+    return present;
+#endif
+}
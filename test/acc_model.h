@@ -0,0 +1,224 @@
+#ifndef ACC_MODEL_H
+#define ACC_MODEL_H
+
+// Functional and cycle-approximate software model of TestAcceleratorModule
+// (src/main/scala/TestAccelerator.scala). Arithmetic follows the Chisel
+// datapath bit for bit: 64-bit wrapping SInt ops, the ILOG tree on the low
+// 32 bits of dd, and the Q32.32 products of FixMult64 with its truncated
+// constants. Shared by the host RoCC emulation (rocc_emu.c), the Spike
+// extension (spike/), the integer-only "fixed" chaining backend
+// (chain_fixed.c) and the Verilator bench (sim/).
+//
+// This is not the arithmetic of indp_chain.c. c_lin is rounded to nearest
+// (out_rounded) where the C code truncates, from .01 truncated to Q32.32; and
+// v_after_trunc shifts the 64-bit Q32.32 gap term right by 64, which leaves
+// only its sign, so CALONEJ subtracts no gap cost at all: the score is
+// sc_1 + sc_2, plus 1 if the scaled gap reaches 2^31 and wraps. Both are
+// modelled as built, so the model checks the RTL and not the intent.
+
+#include <stdint.h>
+#include <string.h>
+
+#define ACC_FN_QSPAN   0
+#define ACC_FN_LPARAMS 1
+#define ACC_FN_COJ     2
+#define ACC_N_FN       3
+
+#define ACC_N_PARAMS   7 // is_cdna, ri, qi, qspan, sidi, avg_qspan (Q32.32), gap_scale (Q32.32)
+
+#define ACC_Q32_ONE    ((int64_t)1 << 32)
+#define ACC_Q32_001    ((int64_t)42949672)   // (0.01 * 2^32).toLong
+#define ACC_Q32_0499   ((int64_t)2143188680) // (0.499 * 2^32).toLong
+
+typedef uint64_t (*acc_load64_f)(void *data, uint64_t addr);
+
+typedef struct
+{
+    int mem_latency;  // cycles from a fired memory request to its response
+    int issue_cycles; // core-side cost of handing one command to the RoCC queue
+} acc_cfg_t;
+
+typedef struct
+{
+    uint64_t addr_mask; // 0xffffffff to mirror the 32-bit address registers; ~0 on a 64-bit host
+    uint64_t base_x;    // anchor array latched by the last QSPAN
+    int64_t params[ACC_N_PARAMS];
+} acc_state_t;
+
+typedef struct
+{
+    uint64_t n_cmd[ACC_N_FN];  // commands issued, per funct
+    uint64_t cycles[ACC_N_FN]; // modelled accelerator busy cycles, per funct
+    uint64_t n_load, bytes;    // memory requests and bytes read
+    uint64_t stall;            // core cycles spent waiting on the accelerator
+} acc_stats_t;
+
+static inline void acc_state_init(acc_state_t *s, uint64_t addr_mask)
+{
+    int k;
+    s->addr_mask = addr_mask, s->base_x = 0;
+    for (k = 0; k < ACC_N_PARAMS; ++k)
+        s->params[k] = 0;
+}
+
+// class ILOG: the compares are signed, so a negative input yields 0
+static inline int32_t acc_ilog32(int32_t x)
+{
+    int32_t r = 0;
+    if (x == 0)
+        return -1;
+    if (x >= 1 << 16)
+        r += 16, x >>= 16;
+    if (x >= 1 << 8)
+        r += 8, x >>= 8;
+    if (x >= 1 << 4)
+        r += 4, x >>= 4;
+    if (x >= 1 << 2)
+        r += 2, x >>= 2;
+    if (x >= 1 << 1)
+        r += 1;
+    return r;
+}
+
+// class FixMult64: the 128-bit product of two Q32.32 values, io.out shifted right by 32 and io.out_rounded by 64
+// after adding 2^63; the Chisel connects keep the low 64 bits
+static inline int64_t acc_fixmul(int64_t a, int64_t b)
+{
+    return (int64_t)(uint64_t)((__int128)a * b >> 32);
+}
+
+static inline int64_t acc_fixmul_rounded(int64_t a, int64_t b)
+{
+    return (int64_t)(uint64_t)((__int128)((unsigned __int128)((__int128)a * b) + ((unsigned __int128)1 << 63)) >> 64);
+}
+
+// m * 2^*e rounded to nearest even at _p_ significant bits, the dropped bits added to *e, as a binary32 (p = 24)
+// operation rounds its exact result; for acc_q32_avg()
+static inline uint64_t acc_rn(unsigned __int128 m, int p, int32_t *e)
+{
+    uint64_t hi = (uint64_t)(m >> 64), lo = (uint64_t)m, r, g;
+    int32_t s = (hi ? 128 - __builtin_clzll(hi) : lo ? 64 - __builtin_clzll(lo) : 0) - p;
+    if (s <= 0)
+        return lo;
+    g = (uint64_t)(m >> (s - 1)), r = g >> 1; // g keeps the guard bit
+    if ((g & 1) && ((r & 1) || (s > 1 && (m << (129 - s)) != 0))) // ties go to even; the shift leaves the sticky bits
+        ++r;
+    if (r >> p)
+        r >>= 1, ++s;
+    *e += s;
+    return r;
+}
+
+// Q32.32 parameters computed without floating point, so that software and
+// hardware paths load the same bits: to_q32_32() of acc_utils.h, which truncates
+// toward zero, of the float gap_scale and of the float avg_qspan = (float)sum / n
+// of the driver, both operands and the quotient rounded to binary32 in
+// acc_q32_avg(); exact from 2^-9 up.
+static inline int64_t acc_q32_from_float(float x)
+{
+    uint32_t u;
+    uint64_t m;
+    int32_t e;
+    int64_t r;
+    memcpy(&u, &x, 4);
+    e = (int32_t)(u >> 23 & 0xff);
+    if (e == 0)
+        return 0; // zero, or a subnormal far below 2^-32
+    m = (u & 0x7fffff) | 0x800000;
+    e -= 127 + 23 - 32; // |x| * 2^32 = m * 2^e
+    if (e >= 40)
+        r = INT64_MAX;
+    else
+        r = e >= 0 ? (int64_t)(m << e) : e > -64 ? (int64_t)(m >> -e) : 0;
+    return u >> 31 ? -r : r;
+}
+
+static inline int64_t acc_q32_avg(uint64_t sum, int64_t n)
+{
+    int32_t es = 0, en = 0, e;
+    uint64_t ms, mn, m;
+    unsigned __int128 q;
+    if (sum == 0 || n <= 0)
+        return 0;
+    ms = acc_rn(sum, 24, &es), mn = acc_rn((uint64_t)n, 24, &en);
+    q = ((unsigned __int128)ms << 64) / mn; // at least 41 bits; a sticky bit below keeps the rounding exact
+    q = q << 1 | (((unsigned __int128)ms << 64) % mn != 0);
+    e = es - en - 65 + 32;
+    m = acc_rn(q, 24, &e);
+    if (e >= 40)
+        return INT64_MAX;
+    return e >= 0 ? (int64_t)(m << e) : e > -64 ? (int64_t)(m >> -e) : 0;
+}
+
+// v_sc_final for predecessor (ajx, ajy) under the loaded parameters
+static inline int64_t acc_coj_score(const int64_t *prm, uint64_t ajx, uint64_t ajy)
+{
+    int64_t is_cdna = prm[0], ri = prm[1], qi = prm[2], qspan = prm[3], sidi = prm[4];
+    int64_t dr, dq, dd, min_d, sc1, sc2, log_dd, c_lin, gap_top, gap, before;
+    int64_t sidj = (int8_t)(ajy >> 48);
+
+    dr = (int64_t)((uint64_t)ri - ajx + 20);
+    dq = (int64_t)((uint64_t)qi - (uint64_t)(int64_t)(int32_t)ajy);
+    dd = dr > dq ? (int64_t)((uint64_t)dr - (uint64_t)dq) : (int64_t)((uint64_t)dq - (uint64_t)dr);
+    min_d = dq < dr ? dq : dr;
+    sc1 = min_d > qspan ? qspan : min_d;
+    log_dd = dd > 0 ? acc_ilog32((int32_t)dd) : 0;
+
+    c_lin = acc_fixmul_rounded(acc_fixmul((int64_t)((uint64_t)dd << 32), ACC_Q32_001), prm[5]);
+    sc2 = sidi != sidj && dr == 0 ? 1 : 0;
+    if (sidi != sidj && dr == 0)
+        gap_top = 0;
+    else if (sidi != sidj || dr > dq)
+        gap_top = c_lin < log_dd ? c_lin : log_dd;
+    else
+        gap_top = c_lin + (log_dd >> 1);
+    gap = is_cdna != 0 || sidi != sidj ? gap_top : c_lin + (log_dd >> 1);
+
+    before = (int64_t)((uint64_t)acc_fixmul((int64_t)((uint64_t)gap << 32), prm[6]) + ACC_Q32_0499);
+    return (int64_t)((uint64_t)(sc1 + sc2) - (uint64_t)(before >> 63)); // v_after_trunc: the sign of before
+}
+
+// Execute one custom0 command; returns the value written to rd, or sets *err for an unknown funct
+static inline uint64_t acc_exec(acc_state_t *s, acc_stats_t *st, const acc_cfg_t *cfg, unsigned funct, uint64_t rs1, uint64_t rs2,
+                                acc_load64_f load, void *data, int *err)
+{
+    uint64_t rd = 0, n_load = 0, cyc, k;
+    *err = 0;
+    if (funct == ACC_FN_QSPAN)
+    {
+        uint32_t sum = 0, n = (uint32_t)rs2;
+        s->base_x = rs1 & s->addr_mask;
+        for (k = 0; k < n; ++k)
+            sum += (uint8_t)(load(data, (s->base_x + 8 + (k << 4)) & s->addr_mask) >> 32);
+        rd = sum, n_load = n;
+        cyc = 4; // IDLE, final SETUP, RET_QSPAN, INST_COMPLETE
+    }
+    else if (funct == ACC_FN_LPARAMS)
+    {
+        uint64_t base = rs1 & s->addr_mask;
+        for (k = 0; k < ACC_N_PARAMS; ++k)
+            s->params[k] = (int64_t)load(data, (base + (k << 3)) & s->addr_mask);
+        n_load = ACC_N_PARAMS;
+        cyc = 3; // IDLE, final SETUP, INST_COMPLETE
+    }
+    else if (funct == ACC_FN_COJ)
+    {
+        uint64_t addr = (s->base_x + ((rs1 & s->addr_mask) << 4)) & s->addr_mask;
+        uint64_t ajx = load(data, addr), ajy = load(data, (addr + 8) & s->addr_mask);
+        rd = (uint64_t)acc_coj_score(s->params, ajx, ajy), n_load = 2;
+        cyc = 4; // IDLE, final SETUP, CALCULATION, INST_COMPLETE
+    }
+    else
+    {
+        *err = 1;
+        return 0;
+    }
+    cyc += n_load * (2 + cfg->mem_latency); // READ_REQ_SETUP + READ_REQ_FIRE + wait in READ_REQ_RESP
+    ++st->n_cmd[funct];
+    st->cycles[funct] += cyc;
+    st->n_load += n_load, st->bytes += n_load * 8;
+    st->stall += cyc + cfg->issue_cycles; // every driver command is fenced, so the core waits it out
+    return rd;
+}
+
+#endif
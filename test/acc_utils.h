@@ -25,16 +25,15 @@ static inline uint64_t ROCC_SUM_QSPAN(mm128_t *source, uint32_t n)
 
 static inline void ROCC_LOAD_PARAMS(void *source)
 {
-    asm volatile("fence");
+    ROCC_FENCE();
     ROCC_INSTRUCTION_SS(0, (uintptr_t)source, 0, 1);
 }
 
 static inline int64_t ROCC_COJ(int64_t j)
 {
     int64_t gap_cost = 0;
-    asm volatile("fence");
+    ROCC_FENCE();
     ROCC_INSTRUCTION_DSS(0, gap_cost, j, 0, 2);
-    printf("unmodified gap_cost = %ld\n", gap_cost); // Debug print
     return gap_cost;
 }
 
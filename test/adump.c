@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !defined(__riscv) || defined(__linux__)
+#define ADUMP_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "adump.h"
+
+struct mm_adump_w_s
+{
+    FILE *fp;
+    uint64_t off, n, m, *idx;
+};
+
+static int adump_pad(mm_adump_w_t *w)
+{
+    static const uint8_t zero[16] = {0};
+    size_t l = (16 - (w->off & 15)) & 15;
+    if (l && fwrite(zero, 1, l, w->fp) != l)
+        return -1;
+    w->off += l;
+    return 0;
+}
+
+mm_adump_w_t *mm_adump_create(const char *fn)
+{
+    mm_adump_w_t *w;
+    mm_adump_fhdr_t fh;
+    FILE *fp;
+    if ((fp = fopen(fn, "wb")) == 0)
+        return 0;
+    memset(&fh, 0, sizeof(fh));
+    memcpy(fh.magic, MM_ADUMP_MAGIC, 4);
+    if (fwrite(&fh, sizeof(fh), 1, fp) != 1) // patched by mm_adump_close()
+    {
+        fclose(fp);
+        return 0;
+    }
+    w = (mm_adump_w_t *)calloc(1, sizeof(mm_adump_w_t));
+    w->fp = fp, w->off = sizeof(fh);
+    return w;
+}
+
+int mm_adump_write(mm_adump_w_t *w, const char *name, const mm_chain_par_t *par, int64_t n, const mm128_t *a)
+{
+    mm_adump_hdr_t h;
+    if (w->n == w->m)
+    {
+        w->m = w->m ? w->m << 1 : 1024;
+        w->idx = (uint64_t *)realloc(w->idx, w->m * 8);
+    }
+    w->idx[w->n++] = w->off;
+    memset(&h, 0, sizeof(h));
+    h.n = n, h.par = *par, h.l_name = strlen(name) + 1;
+    if (fwrite(&h, sizeof(h), 1, w->fp) != 1 || fwrite(name, 1, h.l_name, w->fp) != h.l_name)
+        return -1;
+    w->off += sizeof(h) + h.l_name;
+    if (adump_pad(w) < 0 || (n > 0 && fwrite(a, sizeof(mm128_t), n, w->fp) != (size_t)n))
+        return -1;
+    w->off += n * sizeof(mm128_t);
+    return 0;
+}
+
+int mm_adump_close(mm_adump_w_t *w)
+{
+    mm_adump_fhdr_t fh;
+    int ret = 0;
+    memset(&fh, 0, sizeof(fh));
+    memcpy(fh.magic, MM_ADUMP_MAGIC, 4);
+    fh.n_reads = w->n, fh.idx_off = w->off;
+    if (w->n && fwrite(w->idx, 8, w->n, w->fp) != w->n)
+        ret = -1;
+    if (fseek(w->fp, 0, SEEK_SET) < 0 || fwrite(&fh, sizeof(fh), 1, w->fp) != 1)
+        ret = -1;
+    if (fclose(w->fp) != 0)
+        ret = -1;
+    free(w->idx);
+    free(w);
+    return ret;
+}
+
+mm_adump_t *mm_adump_open(const char *fn)
+{
+    mm_adump_t *d = (mm_adump_t *)calloc(1, sizeof(mm_adump_t));
+    const mm_adump_fhdr_t *fh;
+#ifdef ADUMP_MMAP
+    struct stat s;
+    int fd = open(fn, O_RDONLY);
+    if (fd < 0 || fstat(fd, &s) < 0)
+        goto fail;
+    d->size = s.st_size;
+    d->base = d->size ? (uint8_t *)mmap(0, d->size, PROT_READ, MAP_SHARED, fd, 0) : 0;
+    close(fd), fd = -1;
+    if (d->base == MAP_FAILED)
+    {
+        d->base = 0;
+        goto fail;
+    }
+    d->mapped = 1;
+    madvise(d->base, d->size, MADV_SEQUENTIAL);
+#else // no mmap on bare metal: one read into memory, still no per-record parsing
+    FILE *fp = fopen(fn, "rb");
+    if (fp == 0)
+        goto fail;
+    fseek(fp, 0, SEEK_END);
+    d->size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    d->base = (uint8_t *)malloc(d->size + 1);
+    if (fread(d->base, 1, d->size, fp) != d->size)
+    {
+        fclose(fp);
+        goto fail;
+    }
+    fclose(fp);
+#endif
+    fh = (const mm_adump_fhdr_t *)d->base;
+    if (d->size < sizeof(*fh) || memcmp(fh->magic, MM_ADUMP_MAGIC, 4) != 0 || fh->idx_off + fh->n_reads * 8 > d->size)
+        goto fail;
+    d->n_reads = fh->n_reads;
+    d->idx = (const uint64_t *)(d->base + fh->idx_off);
+    return d;
+
+fail:
+#ifdef ADUMP_MMAP
+    if (fd >= 0)
+        close(fd);
+#endif
+    mm_adump_destroy(d);
+    return 0;
+}
+
+void mm_adump_destroy(mm_adump_t *d)
+{
+    if (d == 0)
+        return;
+#ifdef ADUMP_MMAP
+    if (d->mapped)
+        munmap(d->base, d->size);
+    else
+#endif
+        free(d->base);
+    free(d);
+}
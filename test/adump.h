@@ -0,0 +1,86 @@
+#ifndef ADUMP_H
+#define ADUMP_H
+
+#include "minimap.h"
+#include "chain.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Binary anchor dump: per-read anchor arrays plus the mm_chain_dp() parameters
+// they were chained with, and an offset index, laid out so a reader can mmap
+// the file and use the anchors in place. Host byte order.
+//
+//   file header   magic "MMA\1", flags, n_reads, index offset
+//   record        mm_adump_hdr_t, NUL-terminated name padded to 16, n x mm128_t
+//   ...
+//   index         n_reads x uint64_t record offsets
+//
+// Records start on 16-byte boundaries, so anchors are aligned like kmalloc'd ones.
+
+#define MM_ADUMP_MAGIC "MMA\1"
+
+typedef struct
+{
+    char magic[4];
+    uint32_t flags;
+    uint64_t n_reads, idx_off, reserved;
+} mm_adump_fhdr_t;
+
+typedef struct
+{
+    int64_t n;
+    mm_chain_par_t par;
+    uint32_t l_name; // including the NUL
+    uint32_t reserved[3];
+} mm_adump_hdr_t;
+
+typedef struct
+{
+    const char *name;
+    const mm_chain_par_t *par;
+    int64_t n;
+    const mm128_t *a; // points into the mapping
+} mm_adump_rec_t;
+
+typedef struct mm_adump_w_s mm_adump_w_t;
+
+typedef struct
+{
+    uint8_t *base;
+    size_t size;
+    int mapped;
+    uint64_t n_reads;
+    const uint64_t *idx;
+} mm_adump_t;
+
+mm_adump_w_t *mm_adump_create(const char *fn);
+int mm_adump_write(mm_adump_w_t *w, const char *name, const mm_chain_par_t *par, int64_t n, const mm128_t *a);
+int mm_adump_close(mm_adump_w_t *w); // writes the index; returns 0 on success
+
+mm_adump_t *mm_adump_open(const char *fn);
+void mm_adump_destroy(mm_adump_t *d);
+
+static inline void mm_adump_get(const mm_adump_t *d, uint64_t i, mm_adump_rec_t *r)
+{
+    const mm_adump_hdr_t *h = (const mm_adump_hdr_t *)(d->base + d->idx[i]);
+    r->par = &h->par, r->n = h->n;
+    r->name = (const char *)(h + 1);
+    r->a = (const mm128_t *)((const uint8_t *)r->name + ((h->l_name + 15) & ~15U));
+}
+
+// writer hook with mm_chain_dp()'s argument list; call it right before mm_chain_dp() to capture the workload.
+// Not thread-safe: multi-threaded callers serialise around it or keep one writer per thread.
+static inline int mm_adump_chain_args(mm_adump_w_t *w, const char *name, int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter,
+                                      int min_cnt, int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, const mm128_t *a)
+{
+    mm_chain_par_t cp = {max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n_segs};
+    return mm_adump_write(w, name, &cp, n, a);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
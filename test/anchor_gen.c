@@ -0,0 +1,131 @@
+#include <stdlib.h>
+#include "mmpriv.h"
+#include "anchor_gen.h"
+
+typedef struct
+{
+    uint64_t s;
+} agen_rng_t;
+
+static inline uint64_t agen_next(agen_rng_t *r) // splitmix64
+{
+    uint64_t z = (r->s += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline double agen_drand(agen_rng_t *r)
+{
+    return (agen_next(r) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static inline int64_t agen_range(agen_rng_t *r, int64_t n) // [0, n)
+{
+    return n > 0 ? (int64_t)(agen_next(r) % (uint64_t)n) : 0;
+}
+
+void mm_agen_opt_init(mm_agen_opt_t *opt)
+{
+    opt->n = opt->min_n = 1000;
+    opt->density = 100.0;
+    opt->n_chains = 2;
+    opt->noise_frac = 0.2;
+    opt->rep_frac = 0.1;
+    opt->tandem_frac = 0.0;
+    opt->tandem_period = 50, opt->tandem_copies = 20;
+    opt->rev_frac = 0.5;
+    opt->n_segs = 1;
+    opt->n_targets = 24;
+    opt->target_len = 100000000;
+    opt->q_span = 15;
+    opt->indel_rate = 0.02;
+    opt->seed = 11;
+}
+
+static inline mm128_t agen_anchor(int rev, int64_t rid, int64_t rpos, int seg, int q_span, int64_t qpos)
+{
+    mm128_t p;
+    p.x = (uint64_t)rev << 63 | (uint64_t)rid << 32 | (uint32_t)rpos;
+    p.y = (uint64_t)seg << MM_SEED_SEG_SHIFT | (uint64_t)q_span << 32 | (uint32_t)qpos;
+    return p;
+}
+
+// copy runs of _src_ to fresh loci until _n_ anchors are written to _dst_; period>0 makes tandem copies next to the run
+static void agen_copy_runs(agen_rng_t *r, const mm_agen_opt_t *opt, const mm128_t *src, int64_t n_src, mm128_t *dst, int64_t n, int period)
+{
+    int64_t k = 0;
+    while (k < n && n_src > 0)
+    {
+        int64_t st = agen_range(r, n_src), len = 1 + agen_range(r, 32), c, l;
+        int n_copy = period > 0 ? opt->tandem_copies : 1;
+        uint64_t xhi = src[st].x >> 32 << 32;
+        int64_t shift = 0;
+        if (st + len > n_src)
+            len = n_src - st;
+        if (period <= 0) // another target and strand, same query positions
+            xhi = (uint64_t)(agen_next(r) & 1) << 63 | (uint64_t)agen_range(r, opt->n_targets) << 32, shift = agen_range(r, opt->target_len / 2);
+        for (c = 1; c <= n_copy && k < n; ++c)
+        {
+            for (l = 0; l < len && k < n; ++l)
+            {
+                int64_t rpos = (uint32_t)src[st + l].x;
+                rpos = period > 0 ? rpos + (int64_t)c * period : (rpos + shift) % opt->target_len;
+                dst[k].x = xhi | (uint32_t)rpos, dst[k].y = src[st + l].y, ++k;
+            }
+        }
+    }
+}
+
+mm128_t *mm_agen_read(const mm_agen_opt_t *opt, uint64_t read_id, int64_t *n_)
+{
+    agen_rng_t r;
+    int64_t n, n_noise, n_rep, n_tan, n_base, i, k = 0, qlen = 0;
+    int64_t *qoff;
+    double spacing = 1000.0 / (opt->density > 0 ? opt->density : 1.0);
+    int c, n_chains = opt->n_chains > 0 ? opt->n_chains : 1, n_segs = opt->n_segs > 0 ? opt->n_segs : 1;
+    mm128_t *a;
+
+    r.s = opt->seed ^ (read_id + 1) * 0x9e3779b97f4a7c15ULL;
+    n = opt->min_n < opt->n ? opt->min_n + agen_range(&r, opt->n - opt->min_n + 1) : opt->n;
+    n_noise = (int64_t)(n * opt->noise_frac + .5);
+    n_rep = (int64_t)((n - n_noise) * opt->rep_frac + .5);
+    n_tan = (int64_t)((n - n_noise) * opt->tandem_frac + .5);
+    n_base = n - n_noise - n_rep - n_tan;
+    if (n_base <= 0)
+        n_base = n > 0 ? 1 : 0, n_noise = n - n_base - n_rep - n_tan;
+    if (n_noise < 0)
+        n_rep += n_noise, n_noise = 0;
+    *n_ = n;
+    a = (mm128_t *)malloc((n > 0 ? n : 1) * sizeof(mm128_t));
+    qoff = (int64_t *)calloc(n_segs, sizeof(int64_t));
+
+    // collinear chains; chains of the same segment follow each other along the query
+    for (c = 0; c < n_chains; ++c)
+    {
+        int64_t nc = n_base / n_chains + (c < n_base % n_chains), rid, rpos, q0;
+        int rev = agen_drand(&r) < opt->rev_frac, seg = c % n_segs;
+        if (nc == 0)
+            continue;
+        rid = agen_range(&r, opt->n_targets);
+        rpos = agen_range(&r, opt->target_len - (int64_t)(nc * spacing) - 1024);
+        q0 = qoff[seg];
+        for (i = 0; i < nc; ++i)
+        {
+            int64_t qpos = q0 + (int64_t)(i * spacing) + opt->q_span;
+            if (agen_drand(&r) < opt->indel_rate)
+                rpos += agen_range(&r, 11) - 5; // small gap on one side
+            a[k++] = agen_anchor(rev, rid, rpos + (qpos - q0), seg, opt->q_span, qpos);
+        }
+        qoff[seg] = q0 + (int64_t)(nc * spacing) + opt->q_span + 1;
+        qlen = qoff[seg] > qlen ? qoff[seg] : qlen;
+    }
+    agen_copy_runs(&r, opt, a, k, a + k, n_rep, 0), k += n_rep;
+    agen_copy_runs(&r, opt, a, k - n_rep, a + k, n_tan, opt->tandem_period), k += n_tan;
+    for (i = 0; i < n_noise; ++i)
+        a[k++] = agen_anchor(agen_next(&r) & 1, agen_range(&r, opt->n_targets), agen_range(&r, opt->target_len), agen_range(&r, n_segs), opt->q_span,
+                             opt->q_span + agen_range(&r, qlen > 0 ? qlen : 1000));
+    free(qoff);
+    radix_sort_128x(a, a + n);
+    return a;
+}
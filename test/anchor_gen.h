@@ -0,0 +1,37 @@
+#ifndef ANCHOR_GEN_H
+#define ANCHOR_GEN_H
+
+#include "minimap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Synthetic anchor sets in minimap2's encoding: x = rev<<63 | rid<<32 | rpos,
+// y = seg<<48 | q_span<<32 | qpos, sorted by x as mm_chain_dp() expects.
+typedef struct
+{
+    int64_t n, min_n;    // anchors per read, drawn uniformly from [min_n, n] when min_n < n
+    double density;      // collinear anchors per kb of query
+    int n_chains;        // true collinear chains per read
+    double noise_frac;   // uniformly random anchors
+    double rep_frac;     // chain anchors re-placed as runs at another locus (interspersed repeats)
+    double tandem_frac;  // chain anchors re-placed at tandem_period offsets, piling predecessors into one max_dist_x window
+    int tandem_period, tandem_copies;
+    double rev_frac;     // chains on the reverse strand
+    int n_segs;          // query segments, stored in the MM_SEED_SEG bits of y
+    int n_targets;       // reference sequences
+    int64_t target_len;  // length of every reference sequence
+    int q_span;          // k-mer span
+    double indel_rate;   // per-anchor probability of a small diagonal shift
+    uint64_t seed;
+} mm_agen_opt_t;
+
+void mm_agen_opt_init(mm_agen_opt_t *opt);
+mm128_t *mm_agen_read(const mm_agen_opt_t *opt, uint64_t read_id, int64_t *n_); // malloc'd
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "anchors.h"
+
+static int parse_u64(const char *s, char **end, uint64_t *v)
+{
+    while (*s == ' ' || *s == '\t')
+        ++s;
+    if (*s == '-')
+        *v = (uint64_t)strtoll(s, end, 0);
+    else
+        *v = strtoull(s, end, 0);
+    return *end != s;
+}
+
+static mm_anchors1_t *anchors_push(mm_anchors_t *as, const char *name)
+{
+    mm_anchors1_t *r;
+    if (as->n == as->m)
+    {
+        as->m = as->m ? as->m << 1 : 16;
+        as->r = (mm_anchors1_t *)realloc(as->r, as->m * sizeof(mm_anchors1_t));
+    }
+    r = &as->r[as->n++];
+    r->name = strdup(name);
+    r->n = 0, r->a = 0;
+    return r;
+}
+
+int mm_anchors_read(const char *fn, mm_anchors_t *as)
+{
+    FILE *fp;
+    char line[1024];
+    int64_t m = 0, lineno = 0;
+    mm_anchors1_t *r = 0;
+
+    memset(as, 0, sizeof(mm_anchors_t));
+    fp = fn && strcmp(fn, "-") ? fopen(fn, "r") : stdin;
+    if (fp == 0)
+        return -1;
+    while (fgets(line, sizeof(line), fp))
+    {
+        uint64_t x, y;
+        char *p = line, *q;
+        ++lineno;
+        if (*p == '#' || *p == '\n' || *p == '\r')
+            continue;
+        if (*p == '>')
+        {
+            for (q = ++p; *q && *q != '\n' && *q != '\r' && *q != ' ' && *q != '\t'; ++q)
+                ;
+            *q = 0;
+            r = anchors_push(as, p), m = 0;
+            continue;
+        }
+        if (!parse_u64(p, &q, &x) || !parse_u64(q, &q, &y))
+        {
+            fprintf(stderr, "[%s] %s:%" PRId64 ": expected two integers\n", __func__, fn, lineno);
+            goto fail;
+        }
+        if (r == 0) // anchors before the first header belong to an unnamed read
+            r = anchors_push(as, "read0"), m = 0;
+        if (r->n == m)
+        {
+            m = m ? m + (m >> 1) : 64;
+            r->a = (mm128_t *)realloc(r->a, m * sizeof(mm128_t));
+        }
+        r->a[r->n].x = x, r->a[r->n].y = y, ++r->n;
+    }
+    if (fp != stdin)
+        fclose(fp);
+    return 0;
+
+fail:
+    if (fp != stdin)
+        fclose(fp);
+    mm_anchors_destroy(as);
+    return -1;
+}
+
+void mm_anchors_write1(FILE *fp, const char *name, int64_t n, const mm128_t *a)
+{
+    int64_t i;
+    fprintf(fp, ">%s\n", name);
+    for (i = 0; i < n; ++i)
+        fprintf(fp, "%" PRId64 " %" PRIu64 "\n", (int64_t)a[i].x, a[i].y);
+}
+
+void mm_anchors_destroy(mm_anchors_t *as)
+{
+    int32_t i;
+    for (i = 0; i < as->n; ++i)
+        free(as->r[i].name), free(as->r[i].a);
+    free(as->r);
+    memset(as, 0, sizeof(mm_anchors_t));
+}
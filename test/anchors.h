@@ -0,0 +1,42 @@
+#ifndef ANCHORS_H
+#define ANCHORS_H
+
+#include <stdio.h>
+#include "minimap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Text anchor file, one or more reads:
+//
+//   # comment
+//   >read_name
+//   <a.x> <a.y>
+//   ...
+//
+// a.x and a.y are 64-bit decimal (signed or unsigned) or 0x-prefixed hex,
+// exactly the mm128_t values minimap2 passes to mm_chain_dp().
+
+typedef struct
+{
+    char *name;
+    int64_t n;
+    mm128_t *a;
+} mm_anchors1_t;
+
+typedef struct
+{
+    int32_t n, m;
+    mm_anchors1_t *r;
+} mm_anchors_t;
+
+int mm_anchors_read(const char *fn, mm_anchors_t *as); // returns 0 on success, -1 on I/O or parse error
+void mm_anchors_write1(FILE *fp, const char *name, int64_t n, const mm128_t *a);
+void mm_anchors_destroy(mm_anchors_t *as);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,390 @@
+#include <stdlib.h>
+#include <string.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "chain_impl.h"
+#include "chain_trace.h"
+
+// The fill, for constant _is_cdna_, _multi_ (anchors from more than one segment) and _scaled_ (gap_scale != 1); each
+// combination below is compiled into its own loop, without the tests the constants decide.
+static inline __attribute__((always_inline)) int64_t chain_fill(const mm_chain_fill_t *fl, int64_t st, int64_t i0, int64_t i1, mm_chain_stats_t *cs,
+                                                                const int is_cdna, const int multi, const int scaled)
+{
+    const mm128_t *a = fl->a;
+    const int32_t *lut = fl->lut;
+    int32_t *f = fl->f, *p = fl->p, *t = fl->t, *v = fl->v, n_lut = fl->n_lut;
+    int max_dist_x = fl->max_dist_x, max_skip = fl->max_skip, max_iter = fl->max_iter;
+    float avg_qspan = fl->avg_qspan, gap_scale = fl->gap_scale;
+    mm_chain_adapt_t *ad = fl->ad;
+    int64_t i, j, lo;
+    MM_CHAIN_STAT_COUNT;
+
+    // fill the score and backtrack arrays
+    for (i = i0; i < i1; ++i)
+    {
+        uint64_t ri = a[i].x;
+        int64_t max_j = -1;
+        int32_t qi = (int32_t)a[i].y, q_span = a[i].y >> 32 & 0xff; // NB: only 8 bits of span is used!!!
+        int32_t max_f = q_span, n_skip = 0, tag = fl->t_tag + (int32_t)i;
+        int32_t sidi = multi ? (a[i].y & MM_SEED_SEG_MASK) >> MM_SEED_SEG_SHIFT : 0;
+        while (st < i && ri > a[st].x + max_dist_x)
+            ++st;
+        if (i - st > max_iter)
+            st = i - max_iter;
+        lo = ad ? mm_chain_adapt_lo(ad, i, st) : st;
+        for (j = i - 1; j >= lo; --j)
+        {
+            MM_CHAIN_STAT_INC(n_pred);
+            int64_t dr;
+            int32_t dq, gap_cost;
+            int32_t sc = mm_chain_pair_sc(ri, qi, q_span, sidi, &a[j], lut, n_lut, avg_qspan, gap_scale, &dr, &dq, &gap_cost, is_cdna, multi, scaled);
+            MM_TRACE(MM_TRACE_PAIR, i, j, dr, dq, sc, gap_cost, sc + f[j] > max_f ? j : max_j);
+            sc += f[j];
+            if (sc > max_f)
+            {
+                max_f = sc, max_j = j;
+                if (n_skip > 0)
+                    --n_skip;
+            }
+            else if (t[j] == tag)
+            {
+                if (++n_skip > max_skip)
+                {
+                    MM_CHAIN_STAT_INC(n_skip_exit);
+                    break;
+                }
+            }
+            if (p[j] >= 0)
+                t[p[j]] = tag;
+        }
+        f[i] = max_f, p[i] = max_j;
+        MM_TRACE(MM_TRACE_ROW, i, -1, 0, 0, max_f, 0, max_j);
+        v[i] = max_j >= 0 && v[max_j] > max_f ? v[max_j] : max_f; // v[] keeps the peak score up to i; f[] is the score ending at i, not always the peak
+        if (ad)
+            mm_chain_adapt_row(ad, i, st, lo, j, max_j, max_f, qi, q_span);
+    }
+    MM_CHAIN_STAT_FLUSH(cs);
+    return st;
+}
+
+#define CHAIN_FILL(is_cdna, multi, scaled) \
+    static int64_t chain_fill_##is_cdna##multi##scaled(const mm_chain_fill_t *fl, int64_t st, int64_t i0, int64_t i1, mm_chain_stats_t *cs) \
+    { \
+        return chain_fill(fl, st, i0, i1, cs, is_cdna, multi, scaled); \
+    }
+
+CHAIN_FILL(0, 0, 0)
+CHAIN_FILL(0, 0, 1)
+CHAIN_FILL(0, 1, 0)
+CHAIN_FILL(0, 1, 1)
+CHAIN_FILL(1, 0, 0)
+CHAIN_FILL(1, 0, 1)
+CHAIN_FILL(1, 1, 0)
+CHAIN_FILL(1, 1, 1)
+
+static int64_t (*const chain_fill_kern[8])(const mm_chain_fill_t *, int64_t, int64_t, int64_t, mm_chain_stats_t *) = {
+    chain_fill_000, chain_fill_001, chain_fill_010, chain_fill_011, chain_fill_100, chain_fill_101, chain_fill_110, chain_fill_111,
+};
+
+int64_t mm_chain_fill_st(const mm_chain_fill_t *fl, int64_t st, int64_t i0, int64_t i1, mm_chain_stats_t *cs)
+{
+    // rows only look back to st; one segment there, as always with n_segs == 1, makes every sidi == sidj
+    const mm128_t *a = fl->a;
+    int64_t i;
+    int multi = 0;
+    for (i = st + 1; i < i1 && !multi; ++i)
+        multi = ((a[i].y ^ a[st].y) & MM_SEED_SEG_MASK) != 0;
+    return chain_fill_kern[(fl->is_cdna != 0) << 2 | multi << 1 | (fl->gap_scale != 1.0f)](fl, st, i0, i1, cs);
+}
+
+// n_threads > 1 fills independent blocks in parallel, or with _wave_ a wavefront over the whole read; _ad_ sizes the
+// window of each row
+static mm128_t *chain_dp_st(int n_threads, int wave, mm_chain_adapt_t *ad, int max_dist_x, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale, int is_cdna,
+                            int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws, mm_chain_stats_t *cs)
+{
+    mm_chain_fill_t fl;
+    int32_t *lut = 0, n_lut;
+    uint64_t sum_qspan;
+    MM_CHAIN_STAT_TIMER;
+
+    if (_u)
+        *_u = 0, *n_u_ = 0;
+    if (n == 0 || a == 0)
+    {
+        mm_chain_a_free(km, ws, a);
+        return 0;
+    }
+    sum_qspan = mm_chain_dp_head(km, ws, n, a, &fl.f, &fl.p, &fl.t, &fl.v, &fl.t_tag);
+    fl.avg_qspan = (float)sum_qspan / n;
+    MM_TRACE(MM_TRACE_CALL, n, -1, sum_qspan, 0, 0, 0, -1);
+
+    // same-segment gap costs for dd <= bw from a table, when there are more pairs than entries;
+    // not with tracing, which records gap_cost
+    n_lut = bw < MM_CHAIN_GAP_LUT_MAX ? bw + 1 : MM_CHAIN_GAP_LUT_MAX;
+#ifdef MM_CHAIN_TRACE
+    n_lut = 0;
+#endif
+    if (is_cdna || n_lut <= 0 || n * (n < max_iter ? n : max_iter) / 2 < n_lut)
+        n_lut = 0;
+    else
+        lut = mm_chain_gap_lut(km, ws, n_lut, fl.avg_qspan, gap_scale);
+    fl.max_dist_x = max_dist_x, fl.max_skip = max_skip, fl.max_iter = max_iter, fl.is_cdna = is_cdna;
+    fl.gap_scale = gap_scale, fl.n_lut = n_lut, fl.lut = lut, fl.a = a, fl.ad = ad;
+
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_QSPAN);
+
+    if (n_threads > 1 && wave)
+        mm_chain_fill_wave(&fl, n, n_threads, km, cs);
+    else if (n_threads > 1)
+        mm_chain_fill_blocks(&fl, n, n_threads, cs);
+    else
+        mm_chain_fill_st(&fl, 0, 0, n, cs);
+    if (lut)
+        mm_chain_buf_free(km, ws, lut);
+
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_FILL);
+    return mm_chain_dp_tail(min_cnt, min_sc, n, a, fl.f, fl.p, fl.t, fl.v, fl.t_tag, n_u_, _u, km, ws, cs);
+}
+
+mm128_t *mm_chain_dp_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws, mm_chain_stats_t *cs)
+{ // NB: anchor indices are 32-bit here; mm_chain_dp_compact_st() handles larger n
+    (void)max_dist_y, (void)n_segs;
+    return chain_dp_st(1, 0, 0, max_dist_x, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n, a, n_u_, _u, km, ws, cs);
+}
+
+mm128_t *mm_chain_dp_block_st(int n_threads, int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc,
+                              float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                              mm_chain_stats_t *cs)
+{
+    (void)max_dist_y, (void)n_segs;
+    return chain_dp_st(n_threads, 0, 0, max_dist_x, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n, a, n_u_, _u, km, ws, cs);
+}
+
+mm128_t *mm_chain_dp_wave_st(int n_threads, int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc,
+                             float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                             mm_chain_stats_t *cs)
+{
+    (void)max_dist_y, (void)n_segs;
+    return chain_dp_st(n_threads, 1, 0, max_dist_x, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n, a, n_u_, _u, km, ws, cs);
+}
+
+mm128_t *mm_chain_dp_adapt_st(int w_min, int slack, mm_chain_adapt_rep_t *rep, int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter,
+                              int min_cnt, int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u,
+                              void *km, mm_chain_ws_t *ws, mm_chain_stats_t *cs)
+{
+    mm_chain_adapt_t ad;
+    mm_chain_mq_t *q[3];
+    int64_t w = n < max_iter ? n : max_iter;
+    mm128_t *b;
+    int k;
+    (void)max_dist_y;
+    memset(&ad, 0, sizeof(ad));
+    ad.w_min = w_min > 1 ? w_min : 1, ad.slack = slack > 1 ? slack : 1, ad.bonus = n_segs > 1;
+    for (ad.m = 2; ad.m < w + 2; ad.m <<= 1)
+        ;
+    q[0] = &ad.qu, q[1] = &ad.qk, q[2] = &ad.ql;
+    for (k = 0; k < 3; ++k)
+    {
+        q[k]->r = (int64_t *)kmalloc(km, ad.m * 8);
+        q[k]->x = (int32_t *)kmalloc(km, ad.m * 4);
+    }
+    b = chain_dp_st(1, 0, &ad, max_dist_x, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n, a, n_u_, _u, km, ws, cs);
+    for (k = 0; k < 3; ++k)
+    {
+        kfree(km, q[k]->r);
+        kfree(km, q[k]->x);
+    }
+    if (rep)
+        rep->n_cut = ad.n_cut, rep->loss_ub = ad.max_fu - ad.max_f;
+    return b;
+}
+
+mm128_t *mm_chain_dp_tail(int min_cnt, int min_sc, int64_t n, mm128_t *a, int32_t *f, int32_t *p, int32_t *t, int32_t *v, int32_t t_tag, int *n_u_,
+                          uint64_t **_u, void *km, mm_chain_ws_t *ws, mm_chain_stats_t *cs)
+{
+    int32_t k, n_u, n_v, mark_end = t_tag + (int32_t)n, mark_bt = mark_end + 1; // t[] tags above those of the fill
+    int64_t i, j;
+    uint64_t *u, *u2;
+    mm128_t *b, *w;
+    MM_CHAIN_STAT_DECL;
+
+    // find the ending positions of chains
+    for (i = 0; i < n; ++i)
+        if (p[i] >= 0)
+            t[p[i]] = mark_end;
+    for (i = n_u = 0; i < n; ++i)
+        if (t[i] != mark_end && v[i] >= min_sc)
+            ++n_u;
+    MM_CHAIN_STAT_ADD(cs, n_ends, n_u);
+    if (n_u == 0)
+    {
+        MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_END);
+        MM_CHAIN_STAT_FINISH(cs, n);
+        mm_chain_a_free(km, ws, a);
+        mm_chain_buf_free(km, ws, f);
+        mm_chain_buf_free(km, ws, p);
+        mm_chain_buf_free(km, ws, t);
+        mm_chain_buf_free(km, ws, v);
+        return 0;
+    }
+    u = (uint64_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_U, n_u * 8);
+    for (i = n_u = 0; i < n; ++i)
+    {
+        if (t[i] != mark_end && v[i] >= min_sc)
+        {
+            j = i;
+            while (j >= 0 && f[j] < v[j])
+                j = p[j]; // find the peak that maximizes f[]
+            if (j < 0)
+                j = i; // TODO: this should really be assert(j>=0)
+            u[n_u++] = (uint64_t)f[j] << 32 | j;
+        }
+    }
+    radix_sort_64(u, u + n_u);
+    for (i = 0; i < n_u >> 1; ++i)
+    { // reverse, s.t. the highest scoring chain is the first
+        uint64_t t = u[i];
+        u[i] = u[n_u - i - 1], u[n_u - i - 1] = t;
+    }
+
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_END);
+
+    // backtrack
+    for (i = n_v = k = 0; i < n_u; ++i)
+    { // starting from the highest score
+        int32_t n_v0 = n_v, k0 = k;
+        j = (int32_t)u[i];
+        do
+        {
+            v[n_v++] = j;
+            t[j] = mark_bt;
+            j = p[j];
+        } while (j >= 0 && t[j] != mark_bt);
+        if (j < 0)
+        {
+            if (n_v - n_v0 >= min_cnt)
+                u[k++] = u[i] >> 32 << 32 | (n_v - n_v0);
+        }
+        else if ((int32_t)(u[i] >> 32) - f[j] >= min_sc)
+        {
+            if (n_v - n_v0 >= min_cnt)
+                u[k++] = ((u[i] >> 32) - f[j]) << 32 | (n_v - n_v0);
+        }
+        if (k0 == k)
+            n_v = n_v0; // no new chain added, reset
+    }
+    *n_u_ = n_u = k, *_u = u; // NB: note that u[] may not be sorted by score here
+    MM_CHAIN_STAT_ADD(cs, n_chains, n_u);
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_BT);
+
+    // free temporary arrays
+    mm_chain_buf_free(km, ws, f);
+    mm_chain_buf_free(km, ws, p);
+    mm_chain_buf_free(km, ws, t);
+
+    // order chains by the a[].x of their first anchor, such that adjacent chains may be joined (required by mm_join_long);
+    // chain i is v[k+ni-1], ..., v[k] for its offset k and length ni
+    w = (mm128_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_W, n_u * sizeof(mm128_t));
+    for (i = k = 0; i < n_u; ++i)
+    {
+        w[i].x = a[v[k + (int32_t)u[i] - 1]].x, w[i].y = (uint64_t)k << 32 | i;
+        k += (int32_t)u[i];
+    }
+    radix_sort_128x(w, w + n_u);
+
+    // gather the chains in that order straight into b[], or into the index view of a borrowed _a_
+    if (ws && ws->view)
+    {
+        int64_t *idx = (int64_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_B, n_v * 8);
+        for (i = k = 0; i < n_u; ++i)
+        {
+            int32_t k0 = w[i].y >> 32, ni = (int32_t)u[(int32_t)w[i].y];
+            for (j = 0; j < ni; ++j)
+                idx[k++] = v[k0 + (ni - j - 1)];
+        }
+        ws->idx = idx, b = a;
+    }
+    else
+    {
+        b = (mm128_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_B, n_v * sizeof(mm128_t));
+        for (i = k = 0; i < n_u; ++i)
+        {
+            int32_t k0 = w[i].y >> 32, ni = (int32_t)u[(int32_t)w[i].y];
+            for (j = 0; j < ni; ++j)
+                b[k++] = a[v[k0 + (ni - j - 1)]];
+        }
+        kfree(km, a);
+        MM_CHAIN_STAT_ADD(cs, n_copied, n_v);
+    }
+    u2 = (uint64_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_U2, n_u * 8);
+    for (i = 0; i < n_u; ++i)
+        u2[i] = u[(int32_t)w[i].y];
+    memcpy(u, u2, n_u * 8);
+    mm_chain_buf_free(km, ws, v);
+    mm_chain_buf_free(km, ws, w);
+    mm_chain_buf_free(km, ws, u2);
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_OUT);
+    MM_CHAIN_STAT_FINISH(cs, n);
+    return b;
+}
+
+mm128_t *mm_chain_dp(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km)
+{
+    return mm_chain_dp_st(max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n_segs, n, a, n_u_, _u, km, 0, 0);
+}
+
+void mm_chain_stats_merge(mm_chain_stats_t *dst, const mm_chain_stats_t *src)
+{
+    int k;
+    dst->n_calls += src->n_calls, dst->n_anchors += src->n_anchors;
+    for (k = 0; k < MM_CHAIN_N_PH; ++k)
+        dst->cycles[k] += src->cycles[k];
+    dst->n_pred += src->n_pred, dst->n_skip_exit += src->n_skip_exit;
+    dst->n_ends += src->n_ends, dst->n_chains += src->n_chains, dst->n_copied += src->n_copied;
+}
+
+void mm_chain_stats_print(FILE *fp, const char *label, const mm_chain_stats_t *s)
+{
+    static const char *ph_name[MM_CHAIN_N_PH] = {"qspan", "fill", "end", "backtrack", "output"};
+    uint64_t tot = 0;
+    double na = s->n_anchors ? (double)s->n_anchors : 1.0;
+    int k;
+    for (k = 0; k < MM_CHAIN_N_PH; ++k)
+        tot += s->cycles[k];
+    fprintf(fp, "[%s] calls=%llu anchors=%llu preds=%llu skip_exits=%llu ends=%llu chains=%llu copied=%llu\n", label, (unsigned long long)s->n_calls,
+            (unsigned long long)s->n_anchors, (unsigned long long)s->n_pred, (unsigned long long)s->n_skip_exit, (unsigned long long)s->n_ends,
+            (unsigned long long)s->n_chains, (unsigned long long)s->n_copied);
+    for (k = 0; k < MM_CHAIN_N_PH; ++k)
+        fprintf(fp, "[%s]   %-9s cycles=%llu (%.1f%%) cycles/anchor=%.2f\n", label, ph_name[k], (unsigned long long)s->cycles[k],
+                tot ? 100.0 * s->cycles[k] / tot : 0.0, s->cycles[k] / na);
+}
+
+mm_chain_ws_t *mm_chain_ws_init(void *km)
+{
+    mm_chain_ws_t *ws;
+    ws = (mm_chain_ws_t *)kcalloc(km, 1, sizeof(mm_chain_ws_t));
+    ws->km = km;
+    return ws;
+}
+
+void mm_chain_ws_destroy(mm_chain_ws_t *ws)
+{
+    int k;
+    if (ws == 0)
+        return;
+    for (k = 0; k < MM_CHAIN_WS_N; ++k)
+        kfree(ws->km, ws->buf[k]);
+    kfree(ws->km, ws);
+}
+
+void mm_chain_ws_print(FILE *fp, const char *label, const mm_chain_ws_t *ws)
+{
+    size_t bytes = 0;
+    int k;
+    for (k = 0; k < MM_CHAIN_WS_N; ++k)
+        bytes += ws->m[k];
+    fprintf(fp, "[%s] workspace calls=%llu requests=%llu reallocs=%llu reused=%.2f%% t_clears=%llu bytes=%llu\n", label,
+            (unsigned long long)ws->n_calls, (unsigned long long)ws->n_req, (unsigned long long)ws->n_grow,
+            ws->n_req ? 100.0 * (ws->n_req - ws->n_grow) / ws->n_req : 0.0, (unsigned long long)ws->n_reset, (unsigned long long)bytes);
+}
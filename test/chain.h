@@ -0,0 +1,316 @@
+#ifndef CHAIN_H
+#define CHAIN_H
+
+#include <stdio.h>
+#include "minimap.h"
+#include "cycles.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// mm_chain_dp() parameters, in the order of its argument list; fixed layout, also stored in anchor dumps
+typedef struct
+{
+    int32_t max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc;
+    float gap_scale;
+    int32_t is_cdna, n_segs;
+} mm_chain_par_t;
+
+// phases of mm_chain_dp()
+#define MM_CHAIN_PH_QSPAN 0 // allocation and the sum_qspan pass
+#define MM_CHAIN_PH_FILL  1 // the O(n*window) fill loop
+#define MM_CHAIN_PH_END   2 // chain-end scan and sorting u[]
+#define MM_CHAIN_PH_BT    3 // backtrack
+#define MM_CHAIN_PH_OUT   4 // output gather, re-sort by a[].x and copies
+#define MM_CHAIN_N_PH     5
+
+// Per-phase cost and work counters, filled only when built with -DMM_CHAIN_STATS.
+// Cycles come from mm_cycles(); accumulate over reads with mm_chain_stats_merge().
+typedef struct
+{
+    uint64_t n_calls, n_anchors;
+    uint64_t cycles[MM_CHAIN_N_PH];
+    uint64_t n_pred;      // predecessors scored
+    uint64_t n_skip_exit; // rows cut short by max_skip
+    uint64_t n_ends;      // chain ends with v[] >= min_sc
+    uint64_t n_chains;    // chains kept after backtracking
+    uint64_t n_copied;    // anchors copied by the output stage
+} mm_chain_stats_t;
+
+void mm_chain_stats_merge(mm_chain_stats_t *dst, const mm_chain_stats_t *src);
+void mm_chain_stats_print(FILE *fp, const char *label, const mm_chain_stats_t *s);
+
+// The locals behind the macros below, for a function taking _cs_: MM_CHAIN_STAT_TIMER for PHASE,
+// MM_CHAIN_STAT_COUNT for INC, LADD, FLUSH and FINISH, MM_CHAIN_STAT_DECL for both.
+#ifdef MM_CHAIN_STATS
+#define MM_CHAIN_STAT_TIMER uint64_t cs_t0 = cs ? mm_cycles() : 0, cs_t1
+#define MM_CHAIN_STAT_COUNT uint64_t cs_n_pred = 0, cs_n_skip_exit = 0
+#define MM_CHAIN_STAT_DECL MM_CHAIN_STAT_TIMER; MM_CHAIN_STAT_COUNT
+#define MM_CHAIN_STAT_INC(x) (++cs_##x)
+#define MM_CHAIN_STAT_LADD(x, v) (cs_##x += (v))
+#define MM_CHAIN_STAT_ADD(cs, f, x) do { if (cs) (cs)->f += (x); } while (0)
+#define MM_CHAIN_STAT_PHASE(cs, ph) do { if (cs) cs_t1 = mm_cycles(), (cs)->cycles[ph] += cs_t1 - cs_t0, cs_t0 = cs_t1; } while (0)
+#define MM_CHAIN_STAT_FLUSH(cs) do { if (cs) (cs)->n_pred += cs_n_pred, (cs)->n_skip_exit += cs_n_skip_exit, cs_n_pred = cs_n_skip_exit = 0; } while (0)
+#define MM_CHAIN_STAT_FINISH(cs, n) do { MM_CHAIN_STAT_FLUSH(cs); if (cs) ++(cs)->n_calls, (cs)->n_anchors += (n); } while (0)
+#else
+#define MM_CHAIN_STAT_TIMER (void)cs
+#define MM_CHAIN_STAT_COUNT (void)cs
+#define MM_CHAIN_STAT_DECL (void)cs
+#define MM_CHAIN_STAT_INC(x) ((void)0)
+#define MM_CHAIN_STAT_LADD(x, v) ((void)(v))
+#define MM_CHAIN_STAT_ADD(cs, f, x)
+#define MM_CHAIN_STAT_PHASE(cs, ph)
+#define MM_CHAIN_STAT_FLUSH(cs)
+#define MM_CHAIN_STAT_FINISH(cs, n)
+#endif
+
+// Buffers of mm_chain_dp() kept across calls: grown by 1.5x, never shrunk, allocated from the km given to
+// mm_chain_ws_init(). t[] is tagged with a running epoch instead of being cleared for every read.
+#define MM_CHAIN_WS_F   0
+#define MM_CHAIN_WS_P   1
+#define MM_CHAIN_WS_T   2
+#define MM_CHAIN_WS_V   3
+#define MM_CHAIN_WS_U   4 // returned *_u
+#define MM_CHAIN_WS_B   5 // returned anchors, or idx[]
+#define MM_CHAIN_WS_W   6
+#define MM_CHAIN_WS_U2  7
+#define MM_CHAIN_WS_LUT 8
+#define MM_CHAIN_WS_RMQ 9 // ranks and trees of mm_chain_dp_rmq_st()
+#define MM_CHAIN_WS_N   10
+
+typedef struct
+{
+    void *km;
+    void *buf[MM_CHAIN_WS_N];
+    size_t m[MM_CHAIN_WS_N]; // capacity in bytes
+    int32_t epoch;           // t[] tag of row 0 in the next call; 0 before the first
+
+    // Set view to borrow _a_: it is neither freed nor modified, the backend returns it and chain k (in *_u order)
+    // is a[idx[o]], ..., a[idx[o+l-1]] with o the sum of the earlier lengths, instead of a copy of the anchors
+    int view;
+    const int64_t *idx;
+
+    // reuse counters
+    uint64_t n_calls;
+    uint64_t n_req;   // buffer requests
+    uint64_t n_grow;  // requests that had to reallocate
+    uint64_t n_reset; // t[] clears when the epoch would overflow
+} mm_chain_ws_t;
+
+mm_chain_ws_t *mm_chain_ws_init(void *km);
+void mm_chain_ws_destroy(mm_chain_ws_t *ws);
+void mm_chain_ws_print(FILE *fp, const char *label, const mm_chain_ws_t *ws);
+
+// every chaining backend has the signature and ownership rules of mm_chain_dp(), plus an optional workspace and stats:
+// _a_ is consumed (kfree'd from _km_); the returned anchors and *_u are allocated from _km_ or, given _ws_, live in the
+// workspace until its next use and must not be freed
+typedef mm128_t *(*mm_chain_dp_f)(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                                  int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                                  mm_chain_stats_t *cs);
+
+mm128_t *mm_chain_dp_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale, int is_cdna,
+                        int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws, mm_chain_stats_t *cs);
+
+// mm_chain_dp_st() filling the blocks of anchors that can't chain with each other, split at gaps over max_dist_x and so
+// at every change of strand or target, on up to _n_threads_ threads (needs -DMM_CHAIN_PTHREAD); same output
+mm128_t *mm_chain_dp_block_st(int n_threads, int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc,
+                              float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                              mm_chain_stats_t *cs);
+
+// mm_chain_dp_st() with up to _n_threads_ - 1 threads scoring stripes of rows against their nearest predecessors ahead of
+// the scan, for single reads too long to wait for (chain_wave.c; needs -DMM_CHAIN_PTHREAD and a[] sorted by x); same output
+mm128_t *mm_chain_dp_wave_st(int n_threads, int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc,
+                             float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                             mm_chain_stats_t *cs);
+
+// mm_chain_dp_st() in windows of rows, keeping only the rows later windows or unfinished chains can still reach and
+// spilling chains as they finish (chain_chunk.c); same output. The working set stays near _mem_cap_ bytes unless the
+// rows unfinished chains need exceed it; the largest is recorded in *mem_peak if that is not null.
+mm128_t *mm_chain_dp_chunk_st(size_t mem_cap, size_t *mem_peak, int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt,
+                              int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km,
+                              mm_chain_ws_t *ws, mm_chain_stats_t *cs);
+
+// Outcome of the adaptive window for one read
+typedef struct
+{
+    int64_t n_cut;   // anchors whose predecessor scan stopped at the adaptive window rather than the max_iter one
+    int32_t loss_ub; // the best chain score would be at most this higher with the max_iter window, if the max_skip
+                     // exits stay where they were
+} mm_chain_adapt_rep_t;
+
+// mm_chain_dp_st() scanning each row back at most max(_w_min_, _slack_ x how far recent rows found their predecessor
+// or gave up on max_skip) rows, within max_iter; sparse regions are rarely cut, dense repeats are. The cost in
+// accuracy goes to *rep if that is not null.
+mm128_t *mm_chain_dp_adapt_st(int w_min, int slack, mm_chain_adapt_rep_t *rep, int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter,
+                              int min_cnt, int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u,
+                              void *km, mm_chain_ws_t *ws, mm_chain_stats_t *cs);
+
+// Outcome of mm_chain_screen_st()
+typedef struct
+{
+    int32_t best;   // highest f[] of a row with min_cnt anchors behind it: the score of the best chain when that is kept
+    int n_top;      // entries of top[]
+    int64_t n_fill; // rows filled; below n if min_hit was reached first
+} mm_chain_screen_t;
+
+// The fill of mm_chain_dp_st() without the chain ends, backtrack and output, for reads triaged on their best chain
+// score (chain_screen.c). With _min_hit_ > 0, stops soon after a row reaches it and returns whether one did; otherwise
+// returns whether best >= min_sc. If the fill went to the end, the _k_ highest chain-end peak scores, which bound the
+// scores of the k best chains, go to top[] in decreasing order. _a_ is consumed as by the backends.
+int mm_chain_screen_st(int32_t min_hit, int k, int32_t *top, mm_chain_screen_t *r, int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter,
+                       int min_cnt, int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, void *km, mm_chain_ws_t *ws,
+                       mm_chain_stats_t *cs);
+
+// fill loop in RISC-V vector strips (chain_rvv.c, built with -DMM_CHAIN_RVV for rv64gcv)
+mm128_t *mm_chain_dp_rvv_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                            int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                            mm_chain_stats_t *cs);
+
+// fill loop in AVX2 / AVX-512 strips (chain_x86.c); check the *_avail() CPUID probes before calling
+int mm_chain_avx2_avail(void);
+int mm_chain_avx512_avail(void);
+mm128_t *mm_chain_dp_avx2_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                             int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                             mm_chain_stats_t *cs);
+mm128_t *mm_chain_dp_avx512_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                               int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                               mm_chain_stats_t *cs);
+
+// integer-only scoring, bit-identical to the accelerator, not to mm_chain_dp_st() (chain_fixed.c)
+mm128_t *mm_chain_dp_fixed_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                              int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                              mm_chain_stats_t *cs);
+
+// 16-bit predecessor deltas and skip tags, 64-bit indices, for very large n (chain_compact.c)
+mm128_t *mm_chain_dp_compact_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                                int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                                mm_chain_stats_t *cs);
+
+// O(n log n) chaining by range-maximum query over query positions, after minimap2's mg_lchain_rmq() (chain_rmq.c);
+// same output format, but not the same chains as the max_iter scan
+mm128_t *mm_chain_dp_rmq_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                            int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                            mm_chain_stats_t *cs);
+
+// predecessor scores computed by the custom0 accelerator (acc_chain.c); mm_chain_acc_avail() is 0 on cores without it
+int mm_chain_acc_avail(void);
+mm128_t *mm_chain_dp_acc(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale, int is_cdna,
+                         int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km);
+mm128_t *mm_chain_dp_acc_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale, int is_cdna,
+                            int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws, mm_chain_stats_t *cs);
+
+// mm_chain_screen_st() on the accelerator
+int mm_chain_screen_acc_st(int32_t min_hit, int k, int32_t *top, mm_chain_screen_t *r, int max_dist_x, int max_dist_y, int bw, int max_skip,
+                           int max_iter, int min_cnt, int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, void *km,
+                           mm_chain_ws_t *ws, mm_chain_stats_t *cs);
+
+typedef struct
+{
+    const char *name;
+    mm_chain_dp_f f;
+    int (*avail)(void); // 0 if the CPU lacks the features the backend needs; null for always
+    int prio;           // "auto" prefers higher values; negative to be used only by name
+    int64_t min_n;      // "auto" keeps reads with fewer anchors on a cheaper backend
+} mm_chain_backend_t;
+
+extern const mm_chain_backend_t mm_chain_backends[]; // the first entry is the scalar reference
+extern const int mm_chain_n_backends;
+
+const mm_chain_backend_t *mm_chain_backend_get(const char *name);
+int mm_chain_backend_avail(const mm_chain_backend_t *be);
+// _name_ or, for 0 and "auto", the best available backend for a read of _n_ anchors; 0 if unknown or unavailable
+const mm_chain_backend_t *mm_chain_backend_pick(const char *name, int64_t n);
+
+typedef struct
+{
+    const char *backend; // see mm_chain_backend_pick()
+    const char *backend_long; // if set, used instead for reads of at least long_min_n anchors
+    int64_t long_min_n;
+    int n_block_threads; // above 1, the scalar backend chains each read with mm_chain_dp_block_st()
+    int64_t wave_min_n;  // if set, reads of at least this many anchors go to mm_chain_dp_wave_st() on n_block_threads instead
+    size_t mem_cap;      // if set, the scalar backend chains reads whose f[], p[], t[] and v[] exceed it with mm_chain_dp_chunk_st()
+    int adapt_min;       // if set, and no mem_cap applies, the scalar backend runs mm_chain_dp_adapt_st() with this w_min
+    int adapt_slack;     // and this slack [4]
+    double shadow_frac;  // fraction of calls re-run on the scalar reference and compared
+    int verbose;         // report each shadow mismatch on stderr
+    mm_chain_stats_t *cs; // optional; handed to the chosen backend
+    mm_chain_ws_t *ws;    // optional; likewise, so results belong to it
+
+    // updated by mm_chain_dp_dispatch()
+    uint64_t rng, n_calls, n_shadow, n_mismatch;
+    int64_t shadow_best, shadow_best_ref; // best chain scores of the shadowed reads, summed, on the backend and on the reference
+    int32_t shadow_drop;                  // largest drop of one read's best chain score below the reference's
+    size_t mem_peak; // largest working set of mm_chain_dp_chunk_st()
+    mm_chain_adapt_rep_t adapt; // of the last read, if it ran mm_chain_dp_adapt_st(); zero otherwise
+} mm_chain_opt_t;
+
+void mm_chain_opt_init(mm_chain_opt_t *co);
+
+// Apply _preset_ to _cp_ and _co_, either of which may be null: "map-ont", "map-ul" or "asm" (wider gaps). All of them
+// chain every read with the scan; "rmq" loses best-chain score against it, so only backend_long set by hand selects it.
+// Returns -1 if _preset_ is unknown.
+int mm_chain_preset(const char *preset, mm_chain_par_t *cp, mm_chain_opt_t *co);
+
+// mm_chain_dp() on the backend chosen by _co_; returns 0 with *n_u_ == 0 if co->backend can't run here
+mm128_t *mm_chain_dp_dispatch(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                              int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_opt_t *co);
+
+// one read of a batch (chain_batch.c)
+typedef struct
+{
+    const mm_chain_par_t *par;
+    int64_t n;
+    const mm128_t *a; // not modified; the workers borrow it
+
+    // output of mm_chain_batch(), malloc'd; release with mm_chain_job_free()
+    int n_u;
+    uint64_t *u;
+    mm128_t *b;
+    mm_chain_adapt_rep_t adapt;
+} mm_chain_job_t;
+
+// Chain _jobs_ on _n_threads_ workers, each with its own km pool, through mm_chain_dp_dispatch() with a copy of _co_;
+// call, shadow and stats counters are merged back into _co_. Runs on one thread without -DMM_CHAIN_PTHREAD, while
+// tracing, and for the emulated accelerator. co->ws is ignored; each worker keeps its own. Returns -1 if co->backend can't run here, 0 otherwise.
+int mm_chain_batch(mm_chain_opt_t *co, int n_threads, int64_t n_jobs, mm_chain_job_t *jobs);
+void mm_chain_job_free(int64_t n_jobs, mm_chain_job_t *jobs);
+
+// One read chained while its anchors arrive (chain_inc.c), e.g. to decide on a read before it is fully sequenced.
+// Each mm_chain_inc_add() fills only the rows of the anchors it appends, so its cost doesn't grow with what came
+// before. The gap costs use an average q-span frozen at init, or taken from the first chunk if _avg_qspan_ <= 0;
+// chains then match mm_chain_dp() over all anchors whenever that average is the one of the whole read.
+typedef struct
+{
+    void *km;
+    mm_chain_par_t par;
+    float avg_qspan;
+    int64_t n, m, st; // st: predecessor window start of row n - 1
+    mm128_t *a;
+    int32_t *f, *p, *t, *v, *lut, n_lut;
+    int32_t best_f; // highest f[] so far, at row best_j (-1 before the first anchor), for decisions between chunks
+    int64_t best_j;
+    mm_chain_ws_t *ws; // for mm_chain_inc_chains()
+} mm_chain_inc_t;
+
+mm_chain_inc_t *mm_chain_inc_init(void *km, const mm_chain_par_t *cp, float avg_qspan);
+void mm_chain_inc_destroy(mm_chain_inc_t *ic);
+// append _n_ anchors sorted by a[].x and not before the last one added; -1 if they aren't
+int mm_chain_inc_add(mm_chain_inc_t *ic, int64_t n, const mm128_t *a);
+// the chains of all anchors so far, as mm_chain_dp() returns them, allocated from _km_; _ic_ can take more anchors after
+mm128_t *mm_chain_inc_chains(mm_chain_inc_t *ic, int *n_u_, uint64_t **_u, void *km);
+
+void mm_chain_par_init(mm_chain_par_t *cp); // the values of the example in indp_chain.c
+
+static inline mm128_t *mm_chain_dp_par(mm_chain_dp_f f, const mm_chain_par_t *cp, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km,
+                                       mm_chain_ws_t *ws, mm_chain_stats_t *cs)
+{
+    return f(cp->max_dist_x, cp->max_dist_y, cp->bw, cp->max_skip, cp->max_iter, cp->min_cnt, cp->min_sc, cp->gap_scale, cp->is_cdna, cp->n_segs, n, a,
+             n_u_, _u, km, ws, cs);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
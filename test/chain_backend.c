@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <string.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+
+#define MM_CHAIN_ACC_MIN_N 64 // below this, per-row LOAD_PARAMS and the fences cost more than the offloaded scoring saves
+
+// by name only: CALONEJ drops the gap cost (acc_model.h), so its chains are not the reference's. Auto-selection waits
+// for an RTL that charges it; until then mm_chain_acc_avail() only decides whether "acc" by name is honoured.
+#define MM_CHAIN_ACC_PRIO -1
+#define MM_CHAIN_FIXED_PRIO -1 // the accelerator's scores, for checking it
+
+#define MM_CHAIN_COMPACT_MIN_N ((int64_t)INT32_MAX) // the other backends index anchors with int32_t
+
+const mm_chain_backend_t mm_chain_backends[] = {
+    {"scalar", mm_chain_dp_st, 0, 0, 0},
+#ifdef MM_CHAIN_RVV
+    {"rvv", mm_chain_dp_rvv_st, 0, -1, 0}, // checked only against the host stand-in in rvv_emu/, never cross-built
+#endif
+    {"fixed", mm_chain_dp_fixed_st, 0, MM_CHAIN_FIXED_PRIO, 0},
+#if defined(__x86_64__) && defined(__GNUC__)
+    {"avx2", mm_chain_dp_avx2_st, mm_chain_avx2_avail, -1, 0}, // slower than the scalar fill with its gap-cost table
+    {"avx512", mm_chain_dp_avx512_st, mm_chain_avx512_avail, -1, 0},
+#endif
+    {"acc", mm_chain_dp_acc_st, mm_chain_acc_avail, MM_CHAIN_ACC_PRIO, MM_CHAIN_ACC_MIN_N},
+    {"compact", mm_chain_dp_compact_st, 0, 20, MM_CHAIN_COMPACT_MIN_N},
+    {"rmq", mm_chain_dp_rmq_st, 0, -1, 0}, // finds other chains than the scan; by name or via backend_long
+};
+
+const int mm_chain_n_backends = sizeof(mm_chain_backends) / sizeof(mm_chain_backends[0]);
+
+const mm_chain_backend_t *mm_chain_backend_get(const char *name)
+{
+    int k;
+    for (k = 0; k < mm_chain_n_backends; ++k)
+        if (strcmp(mm_chain_backends[k].name, name) == 0)
+            return &mm_chain_backends[k];
+    return 0;
+}
+
+int mm_chain_backend_avail(const mm_chain_backend_t *be)
+{
+    return be->avail == 0 || be->avail();
+}
+
+const mm_chain_backend_t *mm_chain_backend_pick(const char *name, int64_t n)
+{
+    const mm_chain_backend_t *be = &mm_chain_backends[0];
+    int k;
+    if (name && strcmp(name, "auto") != 0)
+    {
+        be = mm_chain_backend_get(name);
+        return be && mm_chain_backend_avail(be) ? be : 0;
+    }
+    for (k = 1; k < mm_chain_n_backends; ++k)
+    {
+        const mm_chain_backend_t *q = &mm_chain_backends[k];
+        if (q->prio > be->prio && n >= q->min_n && mm_chain_backend_avail(q))
+            be = q;
+    }
+    return be;
+}
+
+void mm_chain_par_init(mm_chain_par_t *cp)
+{
+    cp->max_dist_x = cp->max_dist_y = 5000;
+    cp->bw = 500;
+    cp->max_skip = 25;
+    cp->max_iter = 5000;
+    cp->min_cnt = 3;
+    cp->min_sc = 40;
+    cp->gap_scale = 1.0f;
+    cp->is_cdna = 0;
+    cp->n_segs = 1;
+}
+
+void mm_chain_opt_init(mm_chain_opt_t *co)
+{
+    memset(co, 0, sizeof(mm_chain_opt_t));
+    co->rng = 11;
+    co->adapt_slack = 4;
+}
+
+int mm_chain_preset(const char *preset, mm_chain_par_t *cp, mm_chain_opt_t *co)
+{
+    if (strcmp(preset, "asm") == 0)
+    {
+        if (cp)
+            cp->max_dist_x = cp->max_dist_y = 10000, cp->bw = 1000;
+    }
+    else if (strcmp(preset, "map-ont") != 0 && strcmp(preset, "map-ul") != 0)
+        return -1;
+    if (co)
+        co->backend_long = 0;
+    return 0;
+}
+
+static inline uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static int32_t chain_best(int n_u, const uint64_t *u)
+{
+    int32_t best = 0;
+    int k;
+    for (k = 0; k < n_u; ++k)
+        best = (int32_t)(u[k] >> 32) > best ? (int32_t)(u[k] >> 32) : best;
+    return best;
+}
+
+// _idx0_ is the view of a borrowed _b0_, or null if _b0_ holds copies
+static int chain_same(int n_u0, const uint64_t *u0, const mm128_t *b0, const int64_t *idx0, int n_u1, const uint64_t *u1, const mm128_t *b1)
+{
+    int64_t n_b = 0, i;
+    int k;
+    if (n_u0 != n_u1 || (n_u0 > 0 && memcmp(u0, u1, n_u0 * 8) != 0))
+        return 0;
+    for (k = 0; k < n_u0; ++k)
+        n_b += (int32_t)u0[k];
+    if (idx0)
+    {
+        for (i = 0; i < n_b; ++i)
+            if (b0[idx0[i]].x != b1[i].x || b0[idx0[i]].y != b1[i].y)
+                return 0;
+        return 1;
+    }
+    return n_b == 0 || memcmp(b0, b1, n_b * sizeof(mm128_t)) == 0;
+}
+
+mm128_t *mm_chain_dp_dispatch(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                              int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_opt_t *co)
+{
+    const char *name = co->backend_long && n >= co->long_min_n ? co->backend_long : co->backend;
+    const mm_chain_backend_t *be = mm_chain_backend_pick(name, n);
+    mm128_t *a_ref = 0, *b, *b_ref;
+    uint64_t *u_ref;
+    int n_u_ref, shadow;
+
+    if (be == 0)
+    {
+        fprintf(stderr, "[E::%s] backend '%s' is unknown or not supported here\n", __func__, name);
+        if (_u)
+            *_u = 0, *n_u_ = 0;
+        if (co->ws == 0 || !co->ws->view)
+            kfree(km, a);
+        return 0;
+    }
+    ++co->n_calls;
+    memset(&co->adapt, 0, sizeof(co->adapt));
+    // re-running the reference against itself proves nothing; the backend consumes _a_, so copy it up front
+    shadow = co->shadow_frac > 0.0 && be != &mm_chain_backends[0] && n > 0 && a && _u &&
+             (double)(splitmix64(&co->rng) >> 11) * (1.0 / 9007199254740992.0) < co->shadow_frac;
+    if (shadow)
+    {
+        a_ref = (mm128_t *)kmalloc(km, n * sizeof(mm128_t));
+        memcpy(a_ref, a, n * sizeof(mm128_t));
+    }
+    if (be == &mm_chain_backends[0] && co->mem_cap > 0 && (uint64_t)n * 16 > co->mem_cap)
+        b = mm_chain_dp_chunk_st(co->mem_cap, &co->mem_peak, max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna,
+                                 n_segs, n, a, n_u_, _u, km, co->ws, co->cs);
+    else if (be == &mm_chain_backends[0] && co->adapt_min > 0)
+        b = mm_chain_dp_adapt_st(co->adapt_min, co->adapt_slack, &co->adapt, max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc,
+                                 gap_scale, is_cdna, n_segs, n, a, n_u_, _u, km, co->ws, co->cs);
+    else if (be == &mm_chain_backends[0] && co->n_block_threads > 1 && co->wave_min_n > 0 && n >= co->wave_min_n)
+        b = mm_chain_dp_wave_st(co->n_block_threads, max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n_segs, n,
+                                a, n_u_, _u, km, co->ws, co->cs);
+    else if (be == &mm_chain_backends[0] && co->n_block_threads > 1)
+        b = mm_chain_dp_block_st(co->n_block_threads, max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n_segs, n,
+                                 a, n_u_, _u, km, co->ws, co->cs);
+    else
+        b = be->f(max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n_segs, n, a, n_u_, _u, km, co->ws, co->cs);
+    if (!shadow)
+        return b;
+
+    b_ref = mm_chain_backends[0].f(max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n_segs, n, a_ref, &n_u_ref,
+                                   &u_ref, km, 0, 0);
+    ++co->n_shadow;
+    {
+        int32_t best = chain_best(*n_u_, *_u), best_ref = chain_best(n_u_ref, u_ref);
+        co->shadow_best += best, co->shadow_best_ref += best_ref;
+        if (best_ref - best > co->shadow_drop)
+            co->shadow_drop = best_ref - best;
+    }
+    if (!chain_same(*n_u_, *_u, b, co->ws && co->ws->view ? co->ws->idx : 0, n_u_ref, u_ref, b_ref))
+    {
+        ++co->n_mismatch;
+        if (co->verbose)
+            fprintf(stderr, "[W::%s] backend '%s' differs from '%s' on a read of %ld anchors: %d vs %d chains\n", __func__, be->name,
+                    mm_chain_backends[0].name, (long)n, *n_u_, n_u_ref);
+    }
+    kfree(km, b_ref);
+    kfree(km, u_ref);
+    return b;
+}
@@ -0,0 +1,287 @@
+#include <stdlib.h>
+#include <string.h>
+#ifdef MM_CHAIN_PTHREAD
+#include <pthread.h>
+#endif
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "chain_impl.h"
+#include "chain_trace.h"
+
+// Reads are handed out largest first, round-robin over the workers; a worker
+// that runs out steals from the one with the most left, as kt_for() in
+// minimap2's kthread.c does. Each worker owns a km pool, a chaining workspace
+// and a copy of the dispatcher options, merged back into the caller's when all
+// are done.
+
+struct batch_shared_s;
+
+typedef struct
+{
+    struct batch_shared_s *s;
+    int64_t i; // next position in ord[] this worker takes
+    void *km;
+    mm_chain_opt_t co;
+    mm_chain_stats_t cs;
+} batch_worker_t;
+
+typedef struct batch_shared_s
+{
+    int n_threads;
+    int64_t n_jobs;
+    const mm128_t *ord; // y: job index, by decreasing job size
+    mm_chain_job_t *jobs;
+    batch_worker_t *w;
+} batch_shared_t;
+
+static void batch_run1(batch_worker_t *w, mm_chain_job_t *job)
+{
+    const mm_chain_par_t *cp = job->par;
+    uint64_t *u;
+    int64_t n_b = 0, i;
+    int k;
+
+    // the workspace borrows job->a, which the backends only read, and hands back indices into it
+    mm_chain_dp_dispatch(cp->max_dist_x, cp->max_dist_y, cp->bw, cp->max_skip, cp->max_iter, cp->min_cnt, cp->min_sc, cp->gap_scale, cp->is_cdna,
+                         cp->n_segs, job->n, (mm128_t *)job->a, &job->n_u, &u, w->km, &w->co);
+    job->adapt = w->co.adapt;
+    job->u = 0, job->b = 0;
+    if (job->n_u > 0)
+    {
+        const int64_t *idx = w->co.ws->idx;
+        for (k = 0; k < job->n_u; ++k)
+            n_b += (int32_t)u[k];
+        job->u = (uint64_t *)malloc(job->n_u * 8);
+        memcpy(job->u, u, job->n_u * 8);
+        job->b = (mm128_t *)malloc(n_b * sizeof(mm128_t));
+        for (i = 0; i < n_b; ++i)
+            job->b[i] = job->a[idx[i]];
+    }
+}
+
+static inline int64_t batch_steal(batch_shared_t *s)
+{
+    int k, min_k = -1;
+    int64_t min = INT64_MAX, i;
+    for (k = 0; k < s->n_threads; ++k)
+        if (min > (i = __atomic_load_n(&s->w[k].i, __ATOMIC_RELAXED)))
+            min = i, min_k = k;
+    i = __sync_fetch_and_add(&s->w[min_k].i, s->n_threads);
+    return i >= s->n_jobs ? -1 : i;
+}
+
+static void *batch_worker(void *data)
+{
+    batch_worker_t *w = (batch_worker_t *)data;
+    batch_shared_t *s = w->s;
+    int64_t i;
+    for (;;)
+    {
+        i = __sync_fetch_and_add(&w->i, s->n_threads);
+        if (i >= s->n_jobs)
+            break;
+        batch_run1(w, &s->jobs[s->ord[i].y]);
+    }
+    while ((i = batch_steal(s)) >= 0)
+        batch_run1(w, &s->jobs[s->ord[i].y]);
+    return 0;
+}
+
+int mm_chain_batch(mm_chain_opt_t *co, int n_threads, int64_t n_jobs, mm_chain_job_t *jobs)
+{
+    batch_shared_t s;
+    mm128_t *ord;
+    int64_t i;
+    int k;
+
+    if (mm_chain_backend_pick(co->backend, INT64_MAX) == 0 || (co->backend_long && mm_chain_backend_pick(co->backend_long, INT64_MAX) == 0))
+    {
+        fprintf(stderr, "[E::%s] backend '%s' is unknown or not supported here\n", __func__,
+                mm_chain_backend_pick(co->backend, INT64_MAX) ? co->backend_long : co->backend);
+        return -1;
+    }
+    if (n_jobs <= 0)
+        return 0;
+#ifndef MM_CHAIN_PTHREAD
+    n_threads = 1;
+#endif
+#ifdef ROCC_EMU
+    if ((co->backend && strcmp(co->backend, "acc") == 0) || (co->backend_long && strcmp(co->backend_long, "acc") == 0))
+        n_threads = 1; // rocc_emu.c models the single accelerator of one core
+#endif
+    if (mm_trace_ring.r)
+        n_threads = 1; // one ring per process
+    if (n_threads < 1)
+        n_threads = 1;
+    if (n_threads > n_jobs)
+        n_threads = n_jobs;
+
+    ord = (mm128_t *)malloc(n_jobs * sizeof(mm128_t));
+    for (i = 0; i < n_jobs; ++i)
+        ord[i].x = UINT64_MAX - (uint64_t)jobs[i].n, ord[i].y = i;
+    radix_sort_128x(ord, ord + n_jobs);
+
+    s.n_threads = n_threads, s.n_jobs = n_jobs, s.ord = ord, s.jobs = jobs;
+    s.w = (batch_worker_t *)calloc(n_threads, sizeof(batch_worker_t));
+    for (k = 0; k < n_threads; ++k)
+    {
+        batch_worker_t *w = &s.w[k];
+        w->s = &s, w->i = k;
+        w->km = km_init2(0, 0);
+        w->co = *co;
+        w->co.ws = mm_chain_ws_init(w->km);
+        w->co.ws->view = 1;
+        w->co.cs = co->cs ? &w->cs : 0;
+        w->co.rng = co->rng + k; // distinct shadow-sampling streams
+        w->co.n_calls = w->co.n_shadow = w->co.n_mismatch = 0;
+        w->co.shadow_best = w->co.shadow_best_ref = 0, w->co.shadow_drop = 0;
+    }
+#ifdef MM_CHAIN_PTHREAD
+    if (n_threads > 1)
+    {
+        pthread_t *tid = (pthread_t *)malloc(n_threads * sizeof(pthread_t));
+        uint8_t *live = (uint8_t *)malloc(n_threads);
+        for (k = 0; k < n_threads; ++k)
+            live[k] = pthread_create(&tid[k], 0, batch_worker, &s.w[k]) == 0;
+        for (k = 0; k < n_threads; ++k) // a worker without a thread runs here; the others steal from it meanwhile
+            if (!live[k])
+                batch_worker(&s.w[k]);
+        for (k = 0; k < n_threads; ++k)
+            if (live[k])
+                pthread_join(tid[k], 0);
+        free(live);
+        free(tid);
+    }
+    else
+#endif
+        batch_worker(&s.w[0]);
+
+    for (k = 0; k < n_threads; ++k)
+    {
+        batch_worker_t *w = &s.w[k];
+        co->n_calls += w->co.n_calls, co->n_shadow += w->co.n_shadow, co->n_mismatch += w->co.n_mismatch;
+        co->shadow_best += w->co.shadow_best, co->shadow_best_ref += w->co.shadow_best_ref;
+        co->shadow_drop = co->shadow_drop > w->co.shadow_drop ? co->shadow_drop : w->co.shadow_drop;
+        co->mem_peak = co->mem_peak > w->co.mem_peak ? co->mem_peak : w->co.mem_peak;
+        if (co->cs)
+            mm_chain_stats_merge(co->cs, &w->cs);
+        mm_chain_ws_destroy(w->co.ws);
+        km_destroy(w->km);
+    }
+    co->rng += n_threads;
+    free(s.w);
+    free(ord);
+    return 0;
+}
+
+void mm_chain_job_free(int64_t n_jobs, mm_chain_job_t *jobs)
+{
+    int64_t i;
+    for (i = 0; i < n_jobs; ++i)
+    {
+        free(jobs[i].u);
+        free(jobs[i].b);
+        jobs[i].u = 0, jobs[i].b = 0, jobs[i].n_u = 0;
+    }
+}
+
+#define MM_CHAIN_BLOCK_MIN_N 8192 // reads with fewer anchors are filled on the calling thread
+
+// Blocks of one read are handed out largest first from a shared counter; they
+// write disjoint ranges of f[], p[], t[] and v[].
+
+typedef struct
+{
+    const mm_chain_fill_t *fl;
+    const mm128_t *blk; // x: UINT64_MAX - block size, y: first row
+    int64_t n_blk, next;
+} block_shared_t;
+
+typedef struct
+{
+    block_shared_t *s;
+    mm_chain_stats_t cs, *csp;
+} block_worker_t;
+
+static void *block_worker(void *data)
+{
+    block_worker_t *w = (block_worker_t *)data;
+    block_shared_t *s = w->s;
+    int64_t k;
+    while ((k = __sync_fetch_and_add(&s->next, 1)) < s->n_blk)
+        mm_chain_fill_st(s->fl, s->blk[k].y, s->blk[k].y, s->blk[k].y + (int64_t)(UINT64_MAX - s->blk[k].x), w->csp);
+    return 0;
+}
+
+void mm_chain_fill_blocks(const mm_chain_fill_t *fl, int64_t n, int n_threads, mm_chain_stats_t *cs)
+{
+    const mm128_t *a = fl->a;
+    block_shared_t s;
+    block_worker_t *w;
+    mm128_t *blk;
+    int64_t i, st;
+    int k;
+
+#ifndef MM_CHAIN_PTHREAD
+    n_threads = 1;
+#endif
+    if (mm_trace_ring.r)
+        n_threads = 1; // keep the events in row order
+    if (n_threads <= 1 || n < MM_CHAIN_BLOCK_MIN_N)
+    {
+        mm_chain_fill_st(fl, 0, 0, n, cs);
+        return;
+    }
+    // the split is exact only if a[] is sorted by x, as minimap2 hands it over
+    for (i = 1, s.n_blk = 1; i < n; ++i)
+    {
+        if (a[i].x < a[i - 1].x)
+            break;
+        if (a[i].x > a[i - 1].x + fl->max_dist_x)
+            ++s.n_blk;
+    }
+    if (i < n || s.n_blk == 1)
+    {
+        mm_chain_fill_st(fl, 0, 0, n, cs);
+        return;
+    }
+    blk = (mm128_t *)malloc(s.n_blk * sizeof(mm128_t));
+    for (i = 1, st = 0, s.n_blk = 0; i <= n; ++i)
+    {
+        if (i == n || a[i].x > a[i - 1].x + fl->max_dist_x)
+        {
+            blk[s.n_blk].x = UINT64_MAX - (uint64_t)(i - st), blk[s.n_blk++].y = st;
+            st = i;
+        }
+    }
+    radix_sort_128x(blk, blk + s.n_blk);
+
+    s.fl = fl, s.blk = blk, s.next = 0;
+    if (n_threads > s.n_blk)
+        n_threads = s.n_blk;
+    w = (block_worker_t *)calloc(n_threads, sizeof(block_worker_t));
+    for (k = 0; k < n_threads; ++k)
+        w[k].s = &s, w[k].csp = cs ? &w[k].cs : 0;
+#ifdef MM_CHAIN_PTHREAD
+    {
+        pthread_t *tid = (pthread_t *)malloc(n_threads * sizeof(pthread_t));
+        uint8_t *live = (uint8_t *)malloc(n_threads);
+        for (k = 0; k < n_threads; ++k)
+            live[k] = pthread_create(&tid[k], 0, block_worker, &w[k]) == 0;
+        for (k = 0; k < n_threads; ++k) // the blocks are a shared queue, so this drains whatever the others leave
+            if (!live[k])
+                block_worker(&w[k]);
+        for (k = 0; k < n_threads; ++k)
+            if (live[k])
+                pthread_join(tid[k], 0);
+        free(live);
+        free(tid);
+    }
+#endif
+    if (cs)
+        for (k = 0; k < n_threads; ++k)
+            cs->n_pred += w[k].cs.n_pred, cs->n_skip_exit += w[k].cs.n_skip_exit;
+    free(w);
+    free(blk);
+}
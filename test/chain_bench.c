@@ -0,0 +1,273 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "cycles.h"
+#include "anchors.h"
+#include "anchor_gen.h"
+
+typedef struct
+{
+    int on;
+    uint64_t n_reads, n_anchors, n_preds, ns, cycles, n_diff;
+    size_t peak;
+    mm_chain_stats_t cs;
+    mm_chain_ws_t *ws; // with -W
+} bench_stat_t;
+
+typedef struct
+{
+    int n_u;
+    uint64_t *u;
+    int64_t n_b;
+    mm128_t *b;
+} bench_out_t;
+
+#ifndef MM_CHAIN_STATS
+// sum over i of the predecessor window [st, i) the fill loop starts from, before max_skip cuts it short
+static uint64_t bench_window(const mm_chain_par_t *o, int64_t n, const mm128_t *a)
+{
+    int64_t i, st = 0;
+    uint64_t w = 0;
+    for (i = 0; i < n; ++i)
+    {
+        while (st < i && a[i].x > a[st].x + o->max_dist_x)
+            ++st;
+        w += i - st > o->max_iter ? o->max_iter : i - st;
+    }
+    return w;
+}
+#endif
+
+static void bench_run(const mm_chain_par_t *o, const mm_chain_backend_t *be, int64_t n, const mm128_t *a0, bench_stat_t *s, bench_out_t *out)
+{
+    void *km = km_init2(0, 0x400);
+    mm128_t *a, *b;
+    uint64_t *u, t0, c0;
+    int n_u, i;
+    km_stat_t ks;
+
+    a = (mm128_t *)kmalloc(km, n * sizeof(mm128_t));
+    memcpy(a, a0, n * sizeof(mm128_t));
+    t0 = mm_time_ns(), c0 = mm_cycles();
+    b = mm_chain_dp_par(be->f, o, n, a, &n_u, &u, km, s->ws, &s->cs);
+    s->cycles += mm_cycles() - c0, s->ns += mm_time_ns() - t0;
+    km_stat(km, &ks);
+    if (s->ws)
+        for (i = 0; i < MM_CHAIN_WS_N; ++i)
+            ks.capacity += s->ws->m[i];
+    s->peak = ks.capacity > s->peak ? ks.capacity : s->peak;
+
+    out->n_u = n_u, out->n_b = 0;
+    for (i = 0; i < n_u; ++i)
+        out->n_b += (int32_t)u[i];
+    out->u = (uint64_t *)malloc((n_u > 0 ? n_u : 1) * 8);
+    out->b = (mm128_t *)malloc((out->n_b > 0 ? out->n_b : 1) * sizeof(mm128_t));
+    if (n_u > 0)
+        memcpy(out->u, u, (size_t)n_u * 8);
+    if (out->n_b)
+        memcpy(out->b, b, out->n_b * sizeof(mm128_t));
+    km_destroy(km);
+}
+
+static int bench_same(const bench_out_t *x, const bench_out_t *y)
+{
+    if (x->n_u != y->n_u || x->n_b != y->n_b)
+        return 0;
+    return memcmp(x->u, y->u, x->n_u * 8) == 0 && memcmp(x->b, y->b, x->n_b * sizeof(mm128_t)) == 0;
+}
+
+static void usage(FILE *fp, const mm_chain_par_t *o)
+{
+    int k;
+    fprintf(fp, "Usage: chain_bench [options] [anchors.txt]\n");
+    fprintf(fp, "Without a file, reads are generated in-process (see gen_anchors for the generator).\n");
+    fprintf(fp, "  -b STR     comma-separated backends [all]:");
+    for (k = 0; k < mm_chain_n_backends; ++k)
+        fprintf(fp, " %s", mm_chain_backends[k].name);
+    fprintf(fp, "\n");
+    fprintf(fp, "  -P STR     parameter preset, applied before the options below: map-ont, map-ul, asm\n");
+    fprintf(fp, "  -x INT     max_dist_x [%d]\n", o->max_dist_x);
+    fprintf(fp, "  -y INT     max_dist_y [%d]\n", o->max_dist_y);
+    fprintf(fp, "  -w INT     bw [%d]\n", o->bw);
+    fprintf(fp, "  -s INT     max_skip [%d]\n", o->max_skip);
+    fprintf(fp, "  -i INT     max_iter [%d]\n", o->max_iter);
+    fprintf(fp, "  -c INT     min_cnt [%d]\n", o->min_cnt);
+    fprintf(fp, "  -m INT     min_sc [%d]\n", o->min_sc);
+    fprintf(fp, "  -g FLOAT   gap_scale [%g]\n", o->gap_scale);
+    fprintf(fp, "  -S INT     n_segs [%d]\n", o->n_segs);
+    fprintf(fp, "  -C         is_cdna\n");
+    fprintf(fp, "  -R INT     generated reads [100]\n");
+    fprintf(fp, "  -n INT     anchors per generated read [1000]\n");
+    fprintf(fp, "  -z INT     generator seed [11]\n");
+    fprintf(fp, "  -W         reuse one chaining workspace per backend across reads\n");
+    fprintf(fp, "  -v         per-read output\n");
+}
+
+int main(int argc, char *argv[])
+{
+    mm_chain_par_t o;
+    bench_stat_t *st;
+    mm_agen_opt_t go;
+    mm_anchors_t as;
+    int c, k, verbose = 0, n_gen = 100, ref = -1, use_ws = 0;
+    uint64_t r;
+    const char *sel = 0;
+
+    mm_chain_par_init(&o);
+    st = (bench_stat_t *)calloc(mm_chain_n_backends, sizeof(bench_stat_t));
+    mm_agen_opt_init(&go);
+    while ((c = getopt(argc, argv, "b:P:x:y:w:s:i:c:m:g:S:CR:n:z:Wvh")) >= 0)
+    {
+        if (c == 'b') sel = optarg;
+        else if (c == 'P')
+        {
+            if (mm_chain_preset(optarg, &o, 0) < 0)
+            {
+                fprintf(stderr, "[E::%s] unknown preset '%s'\n", __func__, optarg);
+                return 1;
+            }
+        }
+        else if (c == 'x') o.max_dist_x = atoi(optarg);
+        else if (c == 'y') o.max_dist_y = atoi(optarg);
+        else if (c == 'w') o.bw = atoi(optarg);
+        else if (c == 's') o.max_skip = atoi(optarg);
+        else if (c == 'i') o.max_iter = atoi(optarg);
+        else if (c == 'c') o.min_cnt = atoi(optarg);
+        else if (c == 'm') o.min_sc = atoi(optarg);
+        else if (c == 'g') o.gap_scale = atof(optarg);
+        else if (c == 'S') o.n_segs = atoi(optarg), go.n_segs = o.n_segs;
+        else if (c == 'C') o.is_cdna = 1;
+        else if (c == 'R') n_gen = atoi(optarg);
+        else if (c == 'n') go.n = go.min_n = atol(optarg);
+        else if (c == 'z') go.seed = strtoull(optarg, 0, 10);
+        else if (c == 'W') use_ws = 1;
+        else if (c == 'v') verbose = 1;
+        else if (c == 'h')
+        {
+            usage(stdout, &o);
+            return 0;
+        }
+        else
+        {
+            usage(stderr, &o);
+            return 1;
+        }
+    }
+    for (k = 0; k < mm_chain_n_backends; ++k)
+    {
+        const char *p = sel, *name = mm_chain_backends[k].name;
+        size_t l = strlen(name);
+        for (st[k].on = !sel; p && *p; p += strcspn(p, ","), p += *p == ',')
+            if (strncmp(p, name, l) == 0 && (p[l] == ',' || p[l] == 0))
+                st[k].on = 1;
+        if (st[k].on && !mm_chain_backend_avail(&mm_chain_backends[k]))
+        {
+            if (sel)
+                fprintf(stderr, "[W::%s] backend '%s' is not supported on this CPU; skipped\n", __func__, name);
+            st[k].on = 0;
+        }
+        if (st[k].on && ref < 0)
+            ref = k;
+        if (st[k].on && use_ws)
+            st[k].ws = mm_chain_ws_init(0);
+    }
+    if (ref < 0)
+    {
+        fprintf(stderr, "[E::%s] no known backend in '%s'\n", __func__, sel);
+        return 1;
+    }
+
+    if (optind < argc)
+    {
+        if (mm_anchors_read(argv[optind], &as) < 0)
+        {
+            fprintf(stderr, "[E::%s] failed to read anchors from '%s'\n", __func__, argv[optind]);
+            return 1;
+        }
+    }
+    else
+    {
+        memset(&as, 0, sizeof(as));
+        as.n = as.m = n_gen;
+        as.r = (mm_anchors1_t *)calloc(n_gen, sizeof(mm_anchors1_t));
+        for (r = 0; r < (uint64_t)n_gen; ++r)
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "read%" PRIu64, r);
+            as.r[r].name = strdup(name);
+            as.r[r].a = mm_agen_read(&go, r, &as.r[r].n);
+        }
+    }
+
+    if (verbose)
+        printf("#read\tbackend\tn\tns\tcycles\tn_chains\tsame\n");
+    for (r = 0; r < (uint64_t)as.n; ++r)
+    {
+        const mm_anchors1_t *rd = &as.r[r];
+        bench_out_t out_ref, out;
+        uint64_t win = 0;
+        if (rd->n == 0)
+            continue;
+#ifndef MM_CHAIN_STATS
+        win = bench_window(&o, rd->n, rd->a);
+#endif
+        for (k = 0; k < mm_chain_n_backends; ++k)
+        {
+            uint64_t ns0 = st[k].ns, cyc0 = st[k].cycles;
+            int same = 1;
+            if (!st[k].on)
+                continue;
+            bench_run(&o, &mm_chain_backends[k], rd->n, rd->a, &st[k], k == ref ? &out_ref : &out);
+            if (k != ref)
+            {
+                same = bench_same(&out_ref, &out);
+                st[k].n_diff += !same;
+                free(out.u), free(out.b);
+            }
+            ++st[k].n_reads, st[k].n_anchors += rd->n, st[k].n_preds += win;
+            if (verbose)
+                printf("%s\t%s\t%" PRId64 "\t%" PRIu64 "\t%" PRIu64 "\t%d\t%d\n", rd->name, mm_chain_backends[k].name, rd->n, st[k].ns - ns0,
+                       st[k].cycles - cyc0, k == ref ? out_ref.n_u : out.n_u, same);
+        }
+        free(out_ref.u), free(out_ref.b);
+    }
+
+#ifdef MM_CHAIN_STATS
+    printf("#backend\treads\tanchors\tns/anchor\tcycles/anchor\tpreds/anchor\tpeak_kb\tdiff_reads\n");
+#else
+    printf("#backend\treads\tanchors\tns/anchor\tcycles/anchor\twindow/anchor\tpeak_kb\tdiff_reads\n");
+#endif
+    for (k = 0; k < mm_chain_n_backends; ++k)
+    {
+        const bench_stat_t *s = &st[k];
+        double na = s->n_anchors ? (double)s->n_anchors : 1.0;
+        if (!s->on)
+            continue;
+#ifdef MM_CHAIN_STATS
+        printf("%s\t%" PRIu64 "\t%" PRIu64 "\t%.2f\t%.2f\t%.2f\t%zu\t%" PRIu64 "\n", mm_chain_backends[k].name, s->n_reads, s->n_anchors, s->ns / na,
+               s->cycles / na, s->cs.n_pred / na, s->peak >> 10, s->n_diff);
+#else
+        printf("%s\t%" PRIu64 "\t%" PRIu64 "\t%.2f\t%.2f\t%.2f\t%zu\t%" PRIu64 "\n", mm_chain_backends[k].name, s->n_reads, s->n_anchors, s->ns / na,
+               s->cycles / na, s->n_preds / na, s->peak >> 10, s->n_diff);
+#endif
+    }
+#ifdef MM_CHAIN_STATS
+    for (k = 0; k < mm_chain_n_backends; ++k)
+        if (st[k].on)
+            mm_chain_stats_print(stdout, mm_chain_backends[k].name, &st[k].cs);
+#endif
+    for (k = 0; k < mm_chain_n_backends; ++k)
+        if (st[k].ws)
+        {
+            mm_chain_ws_print(stdout, mm_chain_backends[k].name, st[k].ws);
+            mm_chain_ws_destroy(st[k].ws);
+        }
+    mm_anchors_destroy(&as);
+    free(st);
+    return 0;
+}
@@ -0,0 +1,333 @@
+#include <stdlib.h>
+#include <string.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "chain_impl.h"
+#include "chain_trace.h"
+
+// mm_chain_dp_st() in windows of rows, for reads whose f[], p[], t[] and v[]
+// wouldn't fit a memory cap. Rows of a later window only reach back to st, the
+// window start of the last row filled, so after each window:
+//
+//  - rows [st, n) and their ancestors through p[] (the kept rows) are carried
+//    over, renumbered; no other row can be reached again;
+//  - every other chain end is final, and its backtrack runs in the order of the
+//    tail, claiming rows, until it hits a kept row: a later chain may claim that
+//    row first, as only a later chain can be higher in the order and reach it;
+//  - chains whose backtrack finished are spilled to the output; the others wait
+//    for the next window with the rows they took so far.
+//
+// Claims on rows outside the kept ones only come from chains ending in earlier
+// windows, so the chains and their order are those of the whole-read tail.
+
+#define CK_PTR  1 // the predecessor of some row
+#define CK_KEEP 2 // reachable from later windows
+#define CK_BT   4 // taken by a backtrack
+
+#define MM_CHAIN_CHUNK_ROW_BYTES 29 // g[], f[], p[], t[], v[], map[] and fl[] of a row
+#ifndef MM_CHAIN_CHUNK_MIN
+#define MM_CHAIN_CHUNK_MIN 1024 // fewest rows a window adds, whatever the cap
+#endif
+
+#define CK_GROW(km, ptr, n, m) do { \
+        if ((n) > (m)) { \
+            (m) = (n) > (m) + ((m) >> 1) ? (n) : (m) + ((m) >> 1); \
+            KREALLOC((km), (ptr), (m)); \
+        } \
+    } while (0)
+
+typedef struct
+{
+    uint64_t key; // u << 1 | whether its backtrack has started; u = f << 32 | peak, as sorted by the tail
+    int32_t j;    // row its backtrack continues from
+    int64_t o, n; // rows it took so far, in pth[]
+} chunk_pend_t;
+
+typedef struct
+{
+    uint64_t u, su; // u as in chunk_pend_t; su = score << 32 | length, the output
+    int64_t o;      // rows from the peak back, in out[]
+} chunk_chain_t;
+
+typedef struct
+{
+    void *km;
+    int min_cnt, min_sc;
+    mm_chain_stats_t *cs;
+    // rows of the window: [0, n_s) kept from below the last start, [n_s, n_l) contiguous in a[]
+    int64_t m, n_s, n_l;
+    int64_t *g; // index in a[]
+    int32_t *f, *p, *t, *v, *map;
+    uint8_t *fl;
+    // chains whose backtrack reached a kept row
+    int64_t n_pend, m_pend, n_pth, m_pth;
+    chunk_pend_t *pend;
+    int64_t *pth;
+    // finished chains
+    int64_t n_ch, m_ch, n_out, m_out;
+    chunk_chain_t *ch;
+    int64_t *out;
+} chunk_t;
+
+static void chunk_rows_grow(chunk_t *c, int64_t n)
+{
+    if (n <= c->m)
+        return;
+    c->m = n > c->m + (c->m >> 1) ? n : c->m + (c->m >> 1);
+    KREALLOC(c->km, c->g, c->m);
+    KREALLOC(c->km, c->f, c->m);
+    KREALLOC(c->km, c->p, c->m);
+    KREALLOC(c->km, c->t, c->m);
+    KREALLOC(c->km, c->v, c->m);
+    KREALLOC(c->km, c->map, c->m);
+    KREALLOC(c->km, c->fl, c->m);
+}
+
+// the working set, not counting finished chains, which are output
+static inline void chunk_peak(const chunk_t *c, size_t *mem_peak)
+{
+    size_t sz = c->m * MM_CHAIN_CHUNK_ROW_BYTES + c->m_pend * sizeof(chunk_pend_t) + c->m_pth * sizeof(int64_t);
+    if (mem_peak && *mem_peak < sz)
+        *mem_peak = sz;
+}
+
+// Backtrack every chain ending below row _st_ as far as the rows kept for later windows allow, then drop the others.
+// With st == n_l nothing is kept and every chain finishes.
+static void chunk_step(chunk_t *c, int64_t st)
+{
+    int64_t i, j, k, n_cand, n_pend2 = 0, m_pend2 = 0, n_pth2 = 0, m_pth2 = 0, n_ends = 0;
+    chunk_pend_t *pend2 = 0;
+    int64_t *pth2 = 0;
+    mm128_t *cand;
+
+    memset(c->fl, 0, c->n_l);
+    for (k = 0; k < c->n_l; ++k)
+        if (c->p[k] >= 0)
+            c->fl[c->p[k]] |= CK_PTR;
+    for (k = st; k < c->n_l; ++k)
+        for (j = k; j >= 0 && !(c->fl[j] & CK_KEEP); j = c->p[j])
+            c->fl[j] |= CK_KEEP;
+
+    // new chain ends join the waiting chains; ends kept from an earlier window are never ends
+    for (k = 0; k < c->n_l; ++k)
+    {
+        if ((c->fl[k] & (CK_PTR | CK_KEEP)) == 0 && c->v[k] >= c->min_sc)
+        {
+            chunk_pend_t *q;
+            j = k;
+            while (j >= 0 && c->f[j] < c->v[j])
+                j = c->p[j]; // find the peak that maximizes f[]
+            if (j < 0)
+                j = k;
+            CK_GROW(c->km, c->pend, c->n_pend + 1, c->m_pend);
+            q = &c->pend[c->n_pend++];
+            q->key = ((uint64_t)c->f[j] << 32 | c->g[j]) << 1, q->j = j, q->o = q->n = 0;
+            ++n_ends;
+        }
+    }
+    MM_CHAIN_STAT_ADD(c->cs, n_ends, n_ends);
+    n_cand = c->n_pend;
+    cand = (mm128_t *)kmalloc(c->km, n_cand * sizeof(mm128_t));
+    for (i = 0; i < n_cand; ++i)
+        cand[i].x = ~c->pend[i].key, cand[i].y = i; // a started chain before a new one of the same peak, which stops after it
+    radix_sort_128x(cand, cand + n_cand);
+
+    for (i = 0; i < n_cand; ++i)
+    {
+        chunk_pend_t *q = &c->pend[cand[i].y];
+        uint64_t u = q->key >> 1;
+        int64_t o0 = c->n_out, ni;
+        int first = q->n == 0; // as the tail's do-while, a backtrack takes its peak even if already taken
+
+        if (q->n > 0)
+        {
+            CK_GROW(c->km, c->out, c->n_out + q->n, c->m_out);
+            memcpy(&c->out[c->n_out], &c->pth[q->o], q->n * sizeof(int64_t));
+            c->n_out += q->n;
+        }
+        for (j = q->j; first || (j >= 0 && !(c->fl[j] & CK_BT)); j = c->p[j], first = 0)
+        {
+            if (c->fl[j] & CK_KEEP)
+                break;
+            CK_GROW(c->km, c->out, c->n_out + 1, c->m_out);
+            c->out[c->n_out++] = c->g[j];
+            c->fl[j] |= CK_BT;
+        }
+        ni = c->n_out - o0;
+        if (j >= 0 && (c->fl[j] & CK_KEEP))
+        { // to be continued once the kept rows are settled
+            CK_GROW(c->km, pend2, n_pend2 + 1, m_pend2);
+            if (ni > 0)
+            {
+                CK_GROW(c->km, pth2, n_pth2 + ni, m_pth2);
+                memcpy(&pth2[n_pth2], &c->out[o0], ni * sizeof(int64_t));
+            }
+            pend2[n_pend2].key = u << 1 | (ni > 0), pend2[n_pend2].j = j, pend2[n_pend2].o = n_pth2, pend2[n_pend2++].n = ni;
+            n_pth2 += ni, c->n_out = o0;
+        }
+        else if (ni >= c->min_cnt && (j < 0 || (int32_t)(u >> 32) - c->f[j] >= c->min_sc))
+        {
+            chunk_chain_t *r;
+            CK_GROW(c->km, c->ch, c->n_ch + 1, c->m_ch);
+            r = &c->ch[c->n_ch++];
+            r->u = u, r->o = o0;
+            r->su = (j < 0 ? u >> 32 << 32 : (uint64_t)(uint32_t)((int32_t)(u >> 32) - c->f[j]) << 32) | ni;
+        }
+        else
+            c->n_out = o0; // no new chain added, reset
+    }
+    kfree(c->km, cand);
+    kfree(c->km, c->pend);
+    kfree(c->km, c->pth);
+    c->pend = pend2, c->n_pend = n_pend2, c->m_pend = m_pend2;
+    c->pth = pth2, c->n_pth = n_pth2, c->m_pth = m_pth2;
+
+    // keep the rows later windows can reach; p[] of a kept row points to a kept row
+    for (k = i = c->n_s = 0; k < c->n_l; ++k)
+    {
+        if (!(c->fl[k] & CK_KEEP))
+            continue;
+        c->map[k] = i;
+        c->g[i] = c->g[k], c->f[i] = c->f[k], c->t[i] = c->t[k], c->v[i] = c->v[k];
+        c->p[i] = c->p[k] >= 0 ? c->map[c->p[k]] : -1;
+        c->n_s += k < st;
+        ++i;
+    }
+    for (k = 0; k < c->n_pend; ++k)
+        c->pend[k].j = c->map[c->pend[k].j];
+    c->n_l = i;
+}
+
+mm128_t *mm_chain_dp_chunk_st(size_t mem_cap, size_t *mem_peak, int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt,
+                              int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km,
+                              mm_chain_ws_t *ws, mm_chain_stats_t *cs)
+{
+    chunk_t c;
+    mm_chain_fill_t fl;
+    int32_t *lut = 0, n_lut;
+    uint64_t sum_qspan = 0, *u;
+    int64_t i, j, k, e, e1, st = 0, n_v, max_rows = mem_cap / MM_CHAIN_CHUNK_ROW_BYTES;
+    mm128_t *ord, *w, *b;
+    int n_u;
+    MM_CHAIN_STAT_DECL;
+
+    if (_u)
+        *_u = 0, *n_u_ = 0;
+#ifdef MM_CHAIN_TRACE
+    // the trace numbers rows as one pass over a[] does
+    return mm_chain_dp_st(max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n_segs, n, a, n_u_, _u, km, ws, cs);
+#endif
+    (void)max_dist_y, (void)n_segs;
+    if (n == 0 || a == 0)
+    {
+        mm_chain_a_free(km, ws, a);
+        return 0;
+    }
+    if (n > INT32_MAX - 2)
+    { // t[] tags are 1 + the row in a[]
+        fprintf(stderr, "[E::%s] %ld anchors are more than 32-bit rows can index\n", __func__, (long)n);
+        mm_chain_a_free(km, ws, a);
+        return 0;
+    }
+    for (i = 0; i < n; ++i)
+        sum_qspan += a[i].y >> 32 & 0xff;
+    memset(&c, 0, sizeof(c));
+    c.km = km, c.min_cnt = min_cnt, c.min_sc = min_sc, c.cs = cs;
+    fl.avg_qspan = (float)sum_qspan / n;
+    n_lut = bw < MM_CHAIN_GAP_LUT_MAX ? bw + 1 : MM_CHAIN_GAP_LUT_MAX;
+    if (is_cdna || n_lut <= 0 || n * (n < max_iter ? n : max_iter) / 2 < n_lut)
+        n_lut = 0;
+    else
+        lut = mm_chain_gap_lut(km, 0, n_lut, fl.avg_qspan, gap_scale);
+    fl.max_dist_x = max_dist_x, fl.max_skip = max_skip, fl.max_iter = max_iter, fl.is_cdna = is_cdna;
+    fl.gap_scale = gap_scale, fl.n_lut = n_lut, fl.lut = lut, fl.ad = 0;
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_QSPAN);
+
+    for (e = 0; e < n; e = e1)
+    {
+        int64_t n_add = max_rows - c.n_l > MM_CHAIN_CHUNK_MIN ? max_rows - c.n_l : MM_CHAIN_CHUNK_MIN, off;
+        e1 = n - e > n_add ? e + n_add : n;
+        chunk_rows_grow(&c, c.n_l + (e1 - e));
+        for (i = e; i < e1; ++i)
+            c.g[c.n_l + i - e] = i, c.t[c.n_l + i - e] = 0;
+        // rows from n_s on are a[] from g[n_s] on, so the fill sees them at their own index and tags t[] by row in a[]
+        off = c.g[c.n_s] - c.n_s;
+        fl.a = a + off, fl.t_tag = 1 + (int32_t)off;
+        fl.f = c.f, fl.p = c.p, fl.t = c.t, fl.v = c.v;
+        st = mm_chain_fill_st(&fl, st, c.n_l, c.n_l + (e1 - e), cs);
+        c.n_l += e1 - e;
+        MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_FILL);
+        chunk_peak(&c, mem_peak);
+        chunk_step(&c, e1 == n ? c.n_l : st);
+        chunk_peak(&c, mem_peak);
+        st = c.n_s;
+        MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_BT);
+    }
+    kfree(km, lut);
+    kfree(km, c.g), kfree(km, c.f), kfree(km, c.p), kfree(km, c.t), kfree(km, c.v), kfree(km, c.map), kfree(km, c.fl);
+    kfree(km, c.pend), kfree(km, c.pth);
+
+    // the tail's order: by decreasing u, where the longer chain of a shared peak comes first
+    n_u = c.n_ch;
+    MM_CHAIN_STAT_ADD(cs, n_chains, n_u);
+    if (n_u == 0)
+    {
+        kfree(km, c.ch), kfree(km, c.out);
+        mm_chain_a_free(km, ws, a);
+        MM_CHAIN_STAT_FINISH(cs, n);
+        return 0;
+    }
+    ord = (mm128_t *)kmalloc(km, n_u * sizeof(mm128_t));
+    for (i = 0; i < n_u; ++i)
+        ord[i].x = ~c.ch[i].u, ord[i].y = i;
+    radix_sort_128x(ord, ord + n_u);
+    for (i = 1; i < n_u; ++i)
+        for (j = i; j > 0 && ord[j].x == ord[j - 1].x && (int32_t)c.ch[ord[j].y].su > (int32_t)c.ch[ord[j - 1].y].su; --j)
+        {
+            mm128_t t = ord[j];
+            ord[j] = ord[j - 1], ord[j - 1] = t;
+        }
+
+    // then by the a[].x of the first anchor, sorting the same keys as mm_chain_dp_tail()
+    w = (mm128_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_W, n_u * sizeof(mm128_t));
+    for (i = n_v = 0; i < n_u; ++i)
+    {
+        const chunk_chain_t *r = &c.ch[ord[i].y];
+        w[i].x = a[c.out[r->o + (int32_t)r->su - 1]].x, w[i].y = (uint64_t)n_v << 32 | i;
+        n_v += (int32_t)r->su;
+    }
+    radix_sort_128x(w, w + n_u);
+    u = (uint64_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_U, n_u * 8);
+    for (i = 0; i < n_u; ++i)
+        u[i] = c.ch[ord[(int32_t)w[i].y].y].su;
+    if (ws && ws->view)
+    {
+        int64_t *idx = (int64_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_B, n_v * 8);
+        for (i = k = 0; i < n_u; ++i)
+        {
+            const chunk_chain_t *r = &c.ch[ord[(int32_t)w[i].y].y];
+            for (j = (int32_t)r->su - 1; j >= 0; --j)
+                idx[k++] = c.out[r->o + j];
+        }
+        ws->idx = idx, b = a;
+    }
+    else
+    {
+        b = (mm128_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_B, n_v * sizeof(mm128_t));
+        for (i = k = 0; i < n_u; ++i)
+        {
+            const chunk_chain_t *r = &c.ch[ord[(int32_t)w[i].y].y];
+            for (j = (int32_t)r->su - 1; j >= 0; --j)
+                b[k++] = a[c.out[r->o + j]];
+        }
+        kfree(km, a);
+        MM_CHAIN_STAT_ADD(cs, n_copied, n_v);
+    }
+    kfree(km, ord), kfree(km, c.ch), kfree(km, c.out);
+    mm_chain_buf_free(km, ws, w);
+    *n_u_ = n_u, *_u = u;
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_OUT);
+    MM_CHAIN_STAT_FINISH(cs, n);
+    return b;
+}
@@ -0,0 +1,247 @@
+#include <stdlib.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "chain_impl.h"
+#include "chain_trace.h"
+
+// mm_chain_dp() with narrow working arrays, for reads with a very large number
+// of anchors such as whole-assembly alignment. The fill keeps f[] as int32 and
+// both p[] and t[] in 16 bits, 8 bytes per anchor instead of 16:
+//
+//  - p[i] is the backward distance i - max_j to the predecessor, 0 for none;
+//    max_iter bounds it.
+//  - t[j] holds row tags i % 65535 + 1. A row reads t[j] only for j within
+//    max_iter of it, and every other writer of t[j] lies strictly between j
+//    and the row, so a tag from another row can't alias its own.
+//
+// v[] is built after the fill, once t[] is gone, and the tail marks chain ends
+// and backtracked anchors in a bitset, re-walking p[] to gather the output
+// rather than keeping a list of anchor indices. Indices are 64-bit
+// throughout. Output is bit-identical to mm_chain_dp_st() for max_iter up to
+// MM_CHAIN_COMPACT_MAX_ITER.
+
+// Largest max_iter p[] and t[] can represent; a larger one is clamped to it. Rows then miss predecessors more than
+// 65534 anchors back even when they lie within max_dist_x, which only matters where that many anchors fall in one
+// max_dist_x window and max_skip has not already ended the scan. mm_chain_dp_st() keeps them, at 16 bytes per anchor.
+#define MM_CHAIN_COMPACT_MAX_ITER 65534
+#define MM_CHAIN_COMPACT_MAX_N (1LL << 33) // end keys pack f[] above a 33-bit anchor index
+
+mm128_t *mm_chain_dp_compact_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                                int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                                mm_chain_stats_t *cs)
+{
+    int32_t *f, *v, *lut = 0, n_lut, k, n_u;
+    uint16_t *p, *t, tag;
+    uint64_t *bits, *u, sum_qspan = 0;
+    int64_t i, j, st = 0, n_v, o, *cst;
+    float avg_qspan;
+    mm128_t *b, *w;
+    MM_CHAIN_STAT_DECL;
+
+    (void)max_dist_y, (void)n_segs;
+    if (max_iter > MM_CHAIN_COMPACT_MAX_ITER)
+    {
+        fprintf(stderr, "[W::%s] max_iter %d clamped to %d\n", __func__, max_iter, MM_CHAIN_COMPACT_MAX_ITER);
+        max_iter = MM_CHAIN_COMPACT_MAX_ITER;
+    }
+    if (_u)
+        *_u = 0, *n_u_ = 0;
+    if (n >= MM_CHAIN_COMPACT_MAX_N)
+        fprintf(stderr, "[E::%s] %lld anchors exceed the limit of 2^33\n", __func__, (long long)n);
+    if (n == 0 || a == 0 || n >= MM_CHAIN_COMPACT_MAX_N)
+    {
+        mm_chain_a_free(km, ws, a);
+        return 0;
+    }
+    f = (int32_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_F, n * 4);
+    p = (uint16_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_P, n * 2);
+    t = (uint16_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_T, n * 2);
+    memset(t, 0, n * 2);
+    if (ws)
+        ++ws->n_calls, ws->epoch = 0; // slot T no longer holds int32 tags below the epoch
+    for (i = 0; i < n; ++i)
+        sum_qspan += a[i].y >> 32 & 0xff;
+    avg_qspan = (float)sum_qspan / n;
+    MM_TRACE(MM_TRACE_CALL, n, -1, sum_qspan, 0, 0, 0, -1);
+
+    n_lut = bw < MM_CHAIN_GAP_LUT_MAX ? bw + 1 : MM_CHAIN_GAP_LUT_MAX;
+#ifdef MM_CHAIN_TRACE
+    n_lut = 0;
+#endif
+    if (is_cdna || n_lut <= 0 || n * (n < max_iter ? n : max_iter) / 2 < n_lut)
+        n_lut = 0;
+    else
+        lut = mm_chain_gap_lut(km, ws, n_lut, avg_qspan, gap_scale);
+
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_QSPAN);
+
+    // the fill of mm_chain_dp_st()
+    for (i = 0, tag = 0; i < n; ++i)
+    {
+        uint64_t ri = a[i].x;
+        int64_t max_j = -1;
+        int32_t qi = (int32_t)a[i].y, q_span = a[i].y >> 32 & 0xff;
+        int32_t max_f = q_span, n_skip = 0;
+        int32_t sidi = (a[i].y & MM_SEED_SEG_MASK) >> MM_SEED_SEG_SHIFT;
+        tag = tag == 65535 ? 1 : tag + 1;
+        while (st < i && ri > a[st].x + max_dist_x)
+            ++st;
+        if (i - st > max_iter)
+            st = i - max_iter;
+        for (j = i - 1; j >= st; --j)
+        {
+            int64_t dr;
+            int32_t dq, gap_cost, sc;
+            MM_CHAIN_STAT_INC(n_pred);
+            sc = mm_chain_pair_sc(ri, qi, q_span, sidi, &a[j], lut, n_lut, avg_qspan, gap_scale, &dr, &dq, &gap_cost, is_cdna, 1, 1);
+            MM_TRACE(MM_TRACE_PAIR, i, j, dr, dq, sc, gap_cost, sc + f[j] > max_f ? j : max_j);
+            sc += f[j];
+            if (sc > max_f)
+            {
+                max_f = sc, max_j = j;
+                if (n_skip > 0)
+                    --n_skip;
+            }
+            else if (t[j] == tag)
+            {
+                if (++n_skip > max_skip)
+                {
+                    MM_CHAIN_STAT_INC(n_skip_exit);
+                    break;
+                }
+            }
+            if (p[j])
+                t[j - p[j]] = tag;
+        }
+        f[i] = max_f, p[i] = max_j >= 0 ? (uint16_t)(i - max_j) : 0;
+        MM_TRACE(MM_TRACE_ROW, i, -1, 0, 0, max_f, 0, max_j);
+    }
+    if (lut)
+        mm_chain_buf_free(km, ws, lut);
+    mm_chain_buf_free(km, ws, t);
+
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_FILL);
+    MM_CHAIN_STAT_FLUSH(cs);
+
+    // v[] keeps the peak score up to i, as in the fill of mm_chain_dp_st(); bits[] marks anchors that are a predecessor
+    v = (int32_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_V, n * 4);
+    bits = (uint64_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_T, ((n + 63) >> 6) * 8);
+    memset(bits, 0, ((n + 63) >> 6) * 8);
+    for (i = 0; i < n; ++i)
+    {
+        v[i] = p[i] && v[i - p[i]] > f[i] ? v[i - p[i]] : f[i];
+        if (p[i])
+            j = i - p[i], bits[j >> 6] |= 1ULL << (j & 63);
+    }
+    for (i = n_u = 0; i < n; ++i)
+        if (!(bits[i >> 6] >> (i & 63) & 1) && v[i] >= min_sc)
+            ++n_u;
+    MM_CHAIN_STAT_ADD(cs, n_ends, n_u);
+    if (n_u == 0)
+    {
+        MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_END);
+        MM_CHAIN_STAT_FINISH(cs, n);
+        mm_chain_a_free(km, ws, a);
+        mm_chain_buf_free(km, ws, f);
+        mm_chain_buf_free(km, ws, p);
+        mm_chain_buf_free(km, ws, bits);
+        mm_chain_buf_free(km, ws, v);
+        return 0;
+    }
+    u = (uint64_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_U, n_u * 8);
+    for (i = n_u = 0; i < n; ++i)
+    {
+        if (!(bits[i >> 6] >> (i & 63) & 1) && v[i] >= min_sc)
+        {
+            j = i;
+            while (j >= 0 && f[j] < v[j])
+                j = p[j] ? j - p[j] : -1; // find the peak that maximizes f[]
+            if (j < 0)
+                j = i;
+            u[n_u++] = (uint64_t)f[j] << 33 | j;
+        }
+    }
+    radix_sort_64(u, u + n_u);
+    for (i = 0; i < n_u >> 1; ++i)
+    { // reverse, s.t. the highest scoring chain is the first
+        uint64_t x = u[i];
+        u[i] = u[n_u - i - 1], u[n_u - i - 1] = x;
+    }
+    mm_chain_buf_free(km, ws, v);
+
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_END);
+
+    // backtrack, recording where each kept chain starts in cst[] and the a[].x of its first anchor in w[]
+    memset(bits, 0, ((n + 63) >> 6) * 8);
+    w = (mm128_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_W, n_u * sizeof(mm128_t));
+    cst = (int64_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_U2, n_u * 8);
+    for (i = n_v = k = 0; i < n_u; ++i)
+    {
+        int64_t ni = 0, j0, j1;
+        int32_t sc = u[i] >> 33;
+        j = j0 = u[i] & ((1ULL << 33) - 1);
+        do
+        {
+            ++ni;
+            bits[j >> 6] |= 1ULL << (j & 63);
+            j1 = j;
+            j = p[j] ? j - p[j] : -1;
+        } while (j >= 0 && !(bits[j >> 6] >> (j & 63) & 1));
+        if (j >= 0)
+        {
+            if (sc - f[j] < min_sc)
+                continue;
+            sc -= f[j];
+        }
+        if (ni >= min_cnt)
+        {
+            u[k] = (uint64_t)sc << 32 | (uint32_t)ni, cst[k] = j0;
+            w[k].x = a[j1].x, w[k].y = k;
+            ++k, n_v += ni;
+        }
+    }
+    *n_u_ = n_u = k, *_u = u;
+    MM_CHAIN_STAT_ADD(cs, n_chains, n_u);
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_BT);
+    mm_chain_buf_free(km, ws, f);
+    mm_chain_buf_free(km, ws, bits);
+
+    // order chains by the a[].x of their first anchor and gather each by walking p[] back from its last anchor
+    radix_sort_128x(w, w + n_u);
+    if (ws && ws->view)
+    {
+        int64_t *idx = (int64_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_B, n_v * 8);
+        for (i = o = 0; i < n_u; ++i)
+        {
+            int64_t l, ni = (uint32_t)u[w[i].y];
+            for (l = ni - 1, j = cst[w[i].y]; l >= 0; --l, j -= p[j])
+                idx[o + l] = j;
+            o += ni;
+        }
+        ws->idx = idx, b = a;
+    }
+    else
+    {
+        b = (mm128_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_B, n_v * sizeof(mm128_t));
+        for (i = o = 0; i < n_u; ++i)
+        {
+            int64_t l, ni = (uint32_t)u[w[i].y];
+            for (l = ni - 1, j = cst[w[i].y]; l >= 0; --l, j -= p[j])
+                b[o + l] = a[j];
+            o += ni;
+        }
+        kfree(km, a);
+        MM_CHAIN_STAT_ADD(cs, n_copied, n_v);
+    }
+    for (i = 0; i < n_u; ++i)
+        w[i].x = u[w[i].y];
+    for (i = 0; i < n_u; ++i)
+        u[i] = w[i].x;
+    mm_chain_buf_free(km, ws, p);
+    mm_chain_buf_free(km, ws, w);
+    mm_chain_buf_free(km, ws, cst);
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_OUT);
+    MM_CHAIN_STAT_FINISH(cs, n);
+    return b;
+}
@@ -0,0 +1,40 @@
+#include <stdlib.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "chain_impl.h"
+#include "chain_trace.h"
+#include "acc_model.h"
+
+static int64_t fixed_coj(const int64_t *prm, const mm128_t *a, int64_t j)
+{
+    return acc_coj_score(prm, a[j].x, a[j].y);
+}
+
+// mm_chain_dp() scored with integer arithmetic only: the fill of the "acc"
+// backend, mm_chain_fill_acc(), with each predecessor going through
+// acc_coj_score(), the bit-exact model of the accelerator's CALONEJ, on the
+// core. Output therefore equals the "acc" backend's, which makes this the
+// golden model for checking hardware, and it needs no FPU. It follows the
+// datapath as built, not mm_chain_dp_st() (see acc_model.h).
+mm128_t *mm_chain_dp_fixed_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                              int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                              mm_chain_stats_t *cs)
+{
+    mm_chain_fill_t fl;
+    MM_CHAIN_STAT_TIMER;
+
+    (void)max_dist_y, (void)bw, (void)n_segs;
+    if (_u)
+        *_u = 0, *n_u_ = 0;
+    if (n == 0 || a == 0)
+    {
+        mm_chain_a_free(km, ws, a);
+        return 0;
+    }
+    mm_chain_fill_acc_init(&fl, fixed_coj, max_dist_x, max_skip, max_iter, gap_scale, is_cdna, n, a, km, ws);
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_QSPAN);
+    mm_chain_fill_acc(&fl, 0, 0, n, cs);
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_FILL);
+    return mm_chain_dp_tail(min_cnt, min_sc, n, a, fl.f, fl.p, fl.t, fl.v, fl.t_tag, n_u_, _u, km, ws, cs);
+}
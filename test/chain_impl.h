@@ -0,0 +1,335 @@
+#ifndef CHAIN_IMPL_H
+#define CHAIN_IMPL_H
+
+// Pieces of mm_chain_dp() shared by the chaining backends: the allocation and
+// sum_qspan head, the per-row max/skip bookkeeping the vector fill kernels
+// reduce their strips with, and the chain-end/backtrack/output tail.
+
+#include <string.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+
+static const char LogTable256[256] = {
+#define LT(n) n, n, n, n, n, n, n, n, n, n, n, n, n, n, n, n
+    -1, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3,
+    LT(4), LT(5), LT(5), LT(6), LT(6), LT(6), LT(6),
+    LT(7), LT(7), LT(7), LT(7), LT(7), LT(7), LT(7), LT(7)};
+
+static inline int ilog2_32(uint32_t v)
+{
+    uint32_t t, tt;
+    if ((tt = v >> 16))
+        return (t = tt >> 8) ? 24 + LogTable256[t] : 16 + LogTable256[tt];
+    return (t = v >> 8) ? 8 + LogTable256[t] : LogTable256[v];
+}
+
+// buffer _k_ of _ws_ with room for _size_ bytes, or without _ws_ a fresh one from _km_; contents are undefined
+static inline void *mm_chain_buf(void *km, mm_chain_ws_t *ws, int k, size_t size)
+{
+    size_t m;
+    if (ws == 0)
+        return kmalloc(km, size);
+    ++ws->n_req;
+    if (ws->m[k] >= size)
+        return ws->buf[k];
+    m = ws->m[k] + (ws->m[k] >> 1);
+    m = m > size ? m : size;
+    kfree(ws->km, ws->buf[k]);
+    ws->buf[k] = kmalloc(ws->km, m), ws->m[k] = m;
+    ++ws->n_grow;
+    return ws->buf[k];
+}
+
+static inline void mm_chain_buf_free(void *km, mm_chain_ws_t *ws, void *ptr)
+{
+    if (ws == 0)
+        kfree(km, ptr);
+}
+
+// _a_ is consumed unless a view workspace borrows it
+static inline void mm_chain_a_free(void *km, const mm_chain_ws_t *ws, mm128_t *a)
+{
+    if (ws == 0 || !ws->view)
+        kfree(km, a);
+}
+
+// Allocate f[], p[], t[] and v[] and return sum_qspan. Row i tags t[] with
+// *t_tag + i and the tail marks it with *t_tag + n and + n + 1; every older
+// value in t[] is smaller, so t[] is only cleared when it is new or the epoch
+// of _ws_ would overflow.
+static inline uint64_t mm_chain_dp_head(void *km, mm_chain_ws_t *ws, int64_t n, const mm128_t *a, int32_t **f, int32_t **p, int32_t **t,
+                                        int32_t **v, int32_t *t_tag)
+{
+    uint64_t sum_qspan = 0;
+    int64_t i;
+    *f = (int32_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_F, n * 4);
+    *p = (int32_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_P, n * 4);
+    *v = (int32_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_V, n * 4);
+    if (ws)
+    {
+        uint64_t n_grow = ws->n_grow;
+        *t = (int32_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_T, n * 4);
+        if (ws->n_grow != n_grow || ws->epoch <= 0 || ws->epoch > INT32_MAX - n - 2)
+        {
+            if (ws->n_grow == n_grow)
+                ++ws->n_reset;
+            memset(*t, 0, ws->m[MM_CHAIN_WS_T]);
+            ws->epoch = 1;
+        }
+        *t_tag = ws->epoch, ws->epoch += n + 2;
+        ++ws->n_calls;
+    }
+    else
+    {
+        *t = (int32_t *)kmalloc(km, n * 4);
+        memset(*t, 0, n * 4);
+        *t_tag = 1;
+    }
+    for (i = 0; i < n; ++i)
+        sum_qspan += a[i].y >> 32 & 0xff;
+    return sum_qspan;
+}
+
+#ifndef MM_CHAIN_GAP_LUT_MAX
+#define MM_CHAIN_GAP_LUT_MAX 4096 // largest dd the gap-cost table of mm_chain_dp_st() covers
+#endif
+
+// Gap cost of a same-segment, non-cDNA predecessor as a function of dd alone,
+// for dd in [0, n_lut): the expression of the fill loop evaluated once per dd,
+// so lookups are bit-identical to computing it.
+static inline int32_t *mm_chain_gap_lut(void *km, mm_chain_ws_t *ws, int32_t n_lut, float avg_qspan, float gap_scale)
+{
+    int32_t dd, *lut;
+    lut = (int32_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_LUT, n_lut * 4);
+    for (dd = 0; dd < n_lut; ++dd)
+    {
+        int32_t log_dd = dd ? ilog2_32(dd) : 0;
+        int32_t gap_cost = (int)(dd * .01 * avg_qspan) + (log_dd >> 1);
+        lut[dd] = (int)((double)gap_cost * gap_scale + .499);
+    }
+    return lut;
+}
+
+// Gap-penalised score of predecessor _aj_ for the row at (ri, qi) of the scalar
+// fill; dr, dq and gap_cost are for the trace. Constant _is_cdna_, _multi_ and
+// _scaled_ fold away the tests they decide (see chain_fill() in chain.c).
+static inline __attribute__((always_inline)) int32_t mm_chain_pair_sc(uint64_t ri, int32_t qi, int32_t q_span, int32_t sidi, const mm128_t *aj,
+                                                                      const int32_t *lut, int32_t n_lut, float avg_qspan, float gap_scale,
+                                                                      int64_t *dr_, int32_t *dq_, int32_t *gap_cost_, const int is_cdna,
+                                                                      const int multi, const int scaled)
+{
+    int64_t dr = ri - aj->x + 20;
+    int32_t dq = qi - (int32_t)aj->y, dd, sc, log_dd, min_d, gap_cost;
+    int32_t sidj = multi ? (aj->y & MM_SEED_SEG_MASK) >> MM_SEED_SEG_SHIFT : 0;
+    // if ((sidi == sidj && dr == 0) || dq <= 0)
+    //     continue; // don't skip if an anchor is used by multiple segments; see below
+    // if ((sidi == sidj && dq > max_dist_y) || dq > max_dist_x)
+    //     continue;
+    dd = dr > dq ? dr - dq : dq - dr;
+    // if (sidi == sidj && dd > bw)
+    //     continue;
+    // if (n_segs > 1 && !is_cdna && sidi == sidj && dr > max_dist_y)
+    //     continue;
+    min_d = dq < dr ? dq : dr;
+    sc = min_d > q_span ? q_span : dq < dr ? dq : dr;
+    gap_cost = 0;
+    if (sidi == sidj && (uint32_t)dd < (uint32_t)n_lut)
+        sc -= lut[dd]; // n_lut is 0 for cDNA
+    else
+    {
+        log_dd = dd ? ilog2_32(dd) : 0;
+        if (is_cdna || sidi != sidj)
+        {
+            int c_log, c_lin;
+            c_lin = (int)(dd * .01 * avg_qspan);
+            c_log = log_dd;
+            if (sidi != sidj && dr == 0)
+                ++sc; // possibly due to overlapping paired ends; give a minor bonus
+            else if (dr > dq || sidi != sidj)
+                gap_cost = c_lin < c_log ? c_lin : c_log;
+            else
+                gap_cost = c_lin + (c_log >> 1);
+        }
+        else
+            gap_cost = (int)(dd * .01 * avg_qspan) + (log_dd >> 1);
+        sc -= scaled ? (int)((double)gap_cost * gap_scale + .499) : gap_cost; // gap_cost >= 0
+    }
+    *dr_ = dr, *dq_ = dq, *gap_cost_ = gap_cost;
+    return sc;
+}
+
+// The vector kernels keep dr in 32-bit lanes. That is exact when a[] is sorted by
+// x, as minimap2 hands it over: every predecessor in the window then has
+// 0 <= ri - a[j].x <= max_dist_x. Anything else goes to the scalar reference.
+static inline int mm_chain_dp_lanes_ok(int max_dist_x, int64_t n, const mm128_t *a)
+{
+    int64_t i;
+    if (max_dist_x < 0 || max_dist_x > INT32_MAX - 20)
+        return 0;
+    for (i = 1; i < n; ++i)
+        if (a[i].x < a[i - 1].x)
+            return 0;
+    return 1;
+}
+
+// The sequential part of a fill row: walk predecessors jh, jh-1, ..., jl whose
+// scores (including f[j]) are s[j - jl], updating max_f/max_j/n_skip and t[]
+// exactly as mm_chain_dp() does, with _tag_ the row's t[] tag. Returns the
+// number of predecessors consumed; *stop is set if max_skip ended the row.
+static inline int64_t mm_chain_row_reduce(int32_t tag, int64_t jl, int64_t jh, const int32_t *s, const int32_t *p, int32_t *t, int max_skip,
+                                          int32_t *max_f, int64_t *max_j, int32_t *n_skip, int *stop)
+{
+    int64_t j;
+    for (j = jh; j >= jl; --j)
+    {
+        int32_t sc = s[j - jl];
+        if (sc > *max_f)
+        {
+            *max_f = sc, *max_j = j;
+            if (*n_skip > 0)
+                --*n_skip;
+        }
+        else if (t[j] == tag)
+        {
+            if (++*n_skip > max_skip)
+            {
+                *stop = 1;
+                return jh - j + 1;
+            }
+        }
+        if (p[j] >= 0)
+            t[p[j]] = tag;
+    }
+    return jh - jl + 1;
+}
+
+// Rows of a sliding window by decreasing key, in a ring of m = 2^k entries
+typedef struct
+{
+    int64_t *r, h, t;
+    int32_t *x;
+} mm_chain_mq_t;
+
+static inline void mm_chain_mq_push(mm_chain_mq_t *q, int64_t m, int64_t i, int32_t x)
+{
+    while (q->h < q->t && q->x[(q->t - 1) & (m - 1)] <= x)
+        --q->t;
+    q->r[q->t & (m - 1)] = i, q->x[q->t++ & (m - 1)] = x;
+}
+
+// the largest key of rows st and on; queues of the same rows are empty together
+static inline int32_t mm_chain_mq_max(mm_chain_mq_t *q, int64_t m, int64_t st)
+{
+    while (q->h < q->t && q->r[q->h & (m - 1)] < st)
+        ++q->h;
+    return q->h < q->t ? q->x[q->h & (m - 1)] : INT32_MIN;
+}
+
+// State of the adaptive window of mm_chain_dp_adapt_st(). Row i scans back to
+// i - max(w_min, slack * dmax) at most, dmax being a decaying maximum of how far
+// back recent rows found their predecessor or hit the max_skip exit; rows in
+// dense repeats find them far back, so the window widens with density.
+//
+// fu, for each row, bounds f[] had the row scanned the whole max_iter window,
+// assuming the same max_skip exits. Through a predecessor j, row i gets at most
+//  - fu[j] + q_span + 1, the most a pair can score;
+//  - fu[j] - q[j] + q[i] (+ 1 between segments), as a pair scores at most dq;
+//  - f[i] - f[j] + fu[j], if j was scanned and so is already in f[i].
+// A row cut short may have had any j of its window, others only scanned ones;
+// monotone queues keep the maxima of fu, fu - q and fu - f over the window.
+typedef struct
+{
+    int32_t w_min, slack, bonus;
+    int64_t dmax, m;           // m: size of the rings, a power of 2 above the window
+    mm_chain_mq_t qu, qk, ql;  // by fu, fu - q[] and fu - f[]
+    int64_t n_cut;             // rows that reached the adaptive start before the max_iter one
+    int32_t max_f, max_fu;
+} mm_chain_adapt_t;
+
+static inline int64_t mm_chain_adapt_lo(const mm_chain_adapt_t *ad, int64_t i, int64_t st)
+{
+    int64_t w = ad->slack * ad->dmax;
+    w = w > ad->w_min ? w : ad->w_min;
+    return i - w > st ? i - w : st;
+}
+
+// after row i scanned [j + 1, i) of its window [st, i), where j >= lo is a max_skip exit
+static inline void mm_chain_adapt_row(mm_chain_adapt_t *ad, int64_t i, int64_t st, int64_t lo, int64_t j, int64_t max_j, int32_t f, int32_t qi,
+                                      int32_t q_span)
+{
+    int64_t d = max_j >= 0 ? i - max_j : 0;
+    int32_t u = f, uw = mm_chain_mq_max(&ad->qu, ad->m, st), kw = mm_chain_mq_max(&ad->qk, ad->m, st);
+    int32_t lw = mm_chain_mq_max(&ad->ql, ad->m, st);
+    int cut = lo > st && j < lo;
+
+    if (j >= lo && i - j > d)
+        d = i - j;
+    ad->dmax = d > ad->dmax - (ad->dmax >> 4) ? d : ad->dmax - (ad->dmax >> 4);
+    if (uw != INT32_MIN)
+    {
+        int32_t x = uw + q_span + 1, y = qi + kw + ad->bonus;
+        x = x < y ? x : y;
+        if (!cut && x > f + lw)
+            x = f + lw;
+        u = u > x ? u : x;
+    }
+    ad->n_cut += cut;
+    ad->max_f = ad->max_f > f ? ad->max_f : f;
+    ad->max_fu = ad->max_fu > u ? ad->max_fu : u;
+    mm_chain_mq_push(&ad->qu, ad->m, i, u);
+    mm_chain_mq_push(&ad->qk, ad->m, i, u - qi);
+    mm_chain_mq_push(&ad->ql, ad->m, i, u - f);
+}
+
+// the gap-penalised score of predecessor j under the CALONEJ parameters prm[] (acc_model.h) of the row
+typedef int64_t (*mm_chain_coj_f)(const int64_t *prm, const mm128_t *a, int64_t j);
+
+// what a fill row of mm_chain_dp_st() reads besides its own index
+typedef struct
+{
+    int max_dist_x, max_skip, max_iter, is_cdna;
+    float avg_qspan, gap_scale;
+    int32_t n_lut, t_tag;
+    const int32_t *lut;
+    const mm128_t *a;
+    int32_t *f, *p, *t, *v;
+    mm_chain_adapt_t *ad; // optional
+    int64_t q32_avg_qspan, q32_gap_scale; // Q32.32, for mm_chain_fill_acc() only
+    mm_chain_coj_f coj;                   // for mm_chain_fill_acc(): scores on the core instead of the accelerator if set
+} mm_chain_fill_t;
+
+typedef int64_t (*mm_chain_fill_f)(const mm_chain_fill_t *fl, int64_t st, int64_t i0, int64_t i1, mm_chain_stats_t *cs);
+
+// Rows [i0, i1) of the scalar fill, given _st_, the start of the predecessor window of the previous row (i0 if no row
+// before i0 can reach back past it). Returns that of row i1 - 1, to continue with rows from i1.
+int64_t mm_chain_fill_st(const mm_chain_fill_t *fl, int64_t st, int64_t i0, int64_t i1, mm_chain_stats_t *cs);
+
+// the same with predecessor scores from the accelerator, or from fl->coj (acc_chain.c); ignores lut and ad
+int64_t mm_chain_fill_acc(const mm_chain_fill_t *fl, int64_t st, int64_t i0, int64_t i1, mm_chain_stats_t *cs);
+
+// f[], p[], t[] and v[] from mm_chain_dp_head() and the Q32.32 parameters for mm_chain_fill_acc(), which scores with
+// _coj_ or, if 0, on the accelerator; that then also gets sum_qspan and the anchor array from a QSPAN
+void mm_chain_fill_acc_init(mm_chain_fill_t *fl, mm_chain_coj_f coj, int max_dist_x, int max_skip, int max_iter, float gap_scale, int is_cdna,
+                            int64_t n, mm128_t *a, void *km, mm_chain_ws_t *ws);
+
+// mm_chain_screen_st() after the head, filling with _fill_ (chain_screen.c); takes f[], p[], t[], v[] and _a_ as the tail does
+int mm_chain_screen_fill(mm_chain_fill_f fill, const mm_chain_fill_t *fl, int32_t min_hit, int k, int32_t *top, mm_chain_screen_t *r, int min_cnt,
+                         int min_sc, int64_t n, mm128_t *a, void *km, mm_chain_ws_t *ws, mm_chain_stats_t *cs);
+
+// The whole fill, split where a[i].x > a[i - 1].x + max_dist_x: no row reaches across such a gap, which includes
+// every change of strand or target, so the blocks are independent and run on up to _n_threads_ threads
+// (chain_batch.c). f[], p[], t[] and v[] come out as from mm_chain_fill_st(fl, 0, 0, n, cs).
+void mm_chain_fill_blocks(const mm_chain_fill_t *fl, int64_t n, int n_threads, mm_chain_stats_t *cs);
+
+// The whole fill with the pair scores of each row's nearest predecessors computed ahead by _n_threads_ - 1 helpers
+// (chain_wave.c), for reads that don't split into blocks; needs a[] sorted by x and -DMM_CHAIN_PTHREAD, else runs
+// mm_chain_fill_st(fl, 0, 0, n, cs), as it does if no helper thread starts. Same f[], p[], t[] and v[].
+void mm_chain_fill_wave(const mm_chain_fill_t *fl, int64_t n, int n_threads, void *km, mm_chain_stats_t *cs);
+
+// chain ends, backtrack and output of mm_chain_dp(); takes ownership of f[], p[], t[] and v[] from mm_chain_dp_head() and of _a_
+// unless borrowed
+mm128_t *mm_chain_dp_tail(int min_cnt, int min_sc, int64_t n, mm128_t *a, int32_t *f, int32_t *p, int32_t *t, int32_t *v, int32_t t_tag, int *n_u_,
+                          uint64_t **_u, void *km, mm_chain_ws_t *ws, mm_chain_stats_t *cs);
+
+#endif
@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <string.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "chain_impl.h"
+
+// A read chained as its anchors arrive. Row i of the fill only looks at rows
+// before it, so each chunk extends f[], p[], t[] and v[] by its own rows,
+// resuming the predecessor window where the previous chunk left it; t[] tags
+// keep growing with i and never need clearing. The chain ends, backtrack and
+// output depend on the whole read and run only when chains are asked for.
+
+mm_chain_inc_t *mm_chain_inc_init(void *km, const mm_chain_par_t *cp, float avg_qspan)
+{
+    mm_chain_inc_t *ic;
+    ic = (mm_chain_inc_t *)kcalloc(km, 1, sizeof(mm_chain_inc_t));
+    ic->km = km, ic->par = *cp, ic->avg_qspan = avg_qspan;
+    ic->best_j = -1;
+    ic->ws = mm_chain_ws_init(km);
+    ic->ws->view = 1;
+    return ic;
+}
+
+void mm_chain_inc_destroy(mm_chain_inc_t *ic)
+{
+    if (ic == 0)
+        return;
+    kfree(ic->km, ic->a);
+    kfree(ic->km, ic->f);
+    kfree(ic->km, ic->p);
+    kfree(ic->km, ic->t);
+    kfree(ic->km, ic->v);
+    kfree(ic->km, ic->lut);
+    mm_chain_ws_destroy(ic->ws);
+    kfree(ic->km, ic);
+}
+
+int mm_chain_inc_add(mm_chain_inc_t *ic, int64_t n, const mm128_t *a)
+{
+    const mm_chain_par_t *cp = &ic->par;
+    mm_chain_fill_t fl;
+    int64_t i, n0 = ic->n;
+
+    for (i = 0; i < n; ++i)
+    {
+        if (i == 0 ? n0 > 0 && a[0].x < ic->a[n0 - 1].x : a[i].x < a[i - 1].x)
+        {
+            fprintf(stderr, "[E::%s] anchors must come sorted by a[].x, after those added before\n", __func__);
+            return -1;
+        }
+    }
+    if (n <= 0)
+        return 0;
+    if (n0 + n > INT32_MAX - 2)
+    {
+        fprintf(stderr, "[E::%s] more anchors than the int32_t fill indexes\n", __func__);
+        return -1;
+    }
+    if (n0 + n > ic->m)
+    {
+        int64_t m = ic->m + (ic->m >> 1);
+        m = m > n0 + n ? m : n0 + n;
+        ic->a = (mm128_t *)krealloc(ic->km, ic->a, m * sizeof(mm128_t));
+        ic->f = (int32_t *)krealloc(ic->km, ic->f, m * 4);
+        ic->p = (int32_t *)krealloc(ic->km, ic->p, m * 4);
+        ic->v = (int32_t *)krealloc(ic->km, ic->v, m * 4);
+        ic->t = (int32_t *)krealloc(ic->km, ic->t, m * 4);
+        memset(ic->t + ic->m, 0, (m - ic->m) * 4); // below every row tag
+        ic->m = m;
+    }
+    memcpy(ic->a + n0, a, n * sizeof(mm128_t));
+
+    if (n0 == 0)
+    {
+        if (ic->avg_qspan <= 0.0f)
+        {
+            uint64_t sum_qspan = 0;
+            for (i = 0; i < n; ++i)
+                sum_qspan += a[i].y >> 32 & 0xff;
+            ic->avg_qspan = (float)sum_qspan / n;
+        }
+        ic->n_lut = cp->bw < MM_CHAIN_GAP_LUT_MAX ? cp->bw + 1 : MM_CHAIN_GAP_LUT_MAX;
+#ifdef MM_CHAIN_TRACE
+        ic->n_lut = 0;
+#endif
+        if (cp->is_cdna || ic->n_lut <= 0)
+            ic->n_lut = 0;
+        else
+            ic->lut = mm_chain_gap_lut(ic->km, 0, ic->n_lut, ic->avg_qspan, cp->gap_scale);
+    }
+
+    fl.max_dist_x = cp->max_dist_x, fl.max_skip = cp->max_skip, fl.max_iter = cp->max_iter, fl.is_cdna = cp->is_cdna;
+    fl.avg_qspan = ic->avg_qspan, fl.gap_scale = cp->gap_scale, fl.n_lut = ic->n_lut, fl.t_tag = 1, fl.lut = ic->lut;
+    fl.a = ic->a, fl.f = ic->f, fl.p = ic->p, fl.t = ic->t, fl.v = ic->v, fl.ad = 0;
+    ic->st = mm_chain_fill_st(&fl, ic->st, n0, n0 + n, 0);
+    for (i = n0; i < n0 + n; ++i)
+        if (ic->best_j < 0 || ic->f[i] > ic->best_f)
+            ic->best_f = ic->f[i], ic->best_j = i;
+    ic->n += n;
+    return 0;
+}
+
+mm128_t *mm_chain_inc_chains(mm_chain_inc_t *ic, int *n_u_, uint64_t **_u, void *km)
+{
+    mm_chain_ws_t *ws = ic->ws;
+    int32_t *t, *v;
+    uint64_t *u = 0;
+    mm128_t *b;
+    int64_t n_b = 0, i;
+    int k, n_u = 0;
+
+    *_u = 0, *n_u_ = 0;
+    if (ic->n == 0)
+        return 0;
+    // the tail reuses v[] and marks t[] with tags later rows would have, so it gets copies; f[] and p[] are only read
+    t = (int32_t *)mm_chain_buf(ic->km, ws, MM_CHAIN_WS_T, ic->n * 4);
+    v = (int32_t *)mm_chain_buf(ic->km, ws, MM_CHAIN_WS_V, ic->n * 4);
+    memcpy(t, ic->t, ic->n * 4);
+    memcpy(v, ic->v, ic->n * 4);
+    mm_chain_dp_tail(ic->par.min_cnt, ic->par.min_sc, ic->n, ic->a, ic->f, ic->p, t, v, 1, &n_u, &u, ic->km, ws, 0);
+    if (n_u == 0)
+        return 0;
+    for (k = 0; k < n_u; ++k)
+        n_b += (int32_t)u[k];
+    *_u = (uint64_t *)kmalloc(km, n_u * 8);
+    memcpy(*_u, u, n_u * 8);
+    b = (mm128_t *)kmalloc(km, n_b * sizeof(mm128_t));
+    for (i = 0; i < n_b; ++i)
+        b[i] = ic->a[ws->idx[i]];
+    *n_u_ = n_u;
+    return b;
+}
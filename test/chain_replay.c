@@ -0,0 +1,318 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "cycles.h"
+#include "adump.h"
+#include "chain_trace.h"
+
+#define REPLAY_BATCH 65536 // reads per mm_chain_batch() call; bounds the results held at once
+
+static void usage(FILE *fp)
+{
+    int k;
+    fprintf(fp, "Usage: chain_replay [options] <dump.mma>\n");
+    fprintf(fp, "  -b STR     backend [%s]: auto", mm_chain_backends[0].name);
+    for (k = 0; k < mm_chain_n_backends; ++k)
+        fprintf(fp, " %s", mm_chain_backends[k].name);
+    fprintf(fp, "\n");
+    fprintf(fp, "  -B STR     backend for reads of at least -L anchors [none]\n");
+    fprintf(fp, "  -L INT     anchors from which -B is used [0]\n");
+    fprintf(fp, "  -P STR     chaining preset, clearing -B: map-ont, map-ul, asm\n");
+    fprintf(fp, "  -V FLOAT   fraction of reads re-run on %s to verify the backend [0]\n", mm_chain_backends[0].name);
+    fprintf(fp, "  -D FLOAT   with -V, for backends that find other chains: pass despite mismatches unless the best chain scores of the\n"
+                "             verified reads sum to more than FLOAT below those on %s, as a fraction [off]\n", mm_chain_backends[0].name);
+    fprintf(fp, "  -s INT     first read [0]\n");
+    fprintf(fp, "  -n INT     number of reads [all]\n");
+    fprintf(fp, "  -t INT     number of threads [1]\n");
+    fprintf(fp, "  -j INT     threads per read for its independent anchor blocks, %s only [1]\n", mm_chain_backends[0].name);
+    fprintf(fp, "  -w INT     with -j, fill reads of at least INT anchors as a wavefront over all -j threads instead of by blocks [0]\n");
+    fprintf(fp, "  -M NUM     cap on the working set of a read on %s, in bytes, k/m/g allowed; chains longer reads in windows [0]\n",
+            mm_chain_backends[0].name);
+    fprintf(fp, "  -a INT     adaptive predecessor window of at least INT rows on %s; -v adds '#name cut loss' per read [0]\n",
+            mm_chain_backends[0].name);
+    fprintf(fp, "  -A INT     adaptive window slack [4]\n");
+    fprintf(fp, "  -H INT     screen each read for a chain scoring INT or more, on %s or acc, without chaining it; 0 fills whole reads [off]\n",
+            mm_chain_backends[0].name);
+    fprintf(fp, "  -K INT     with -H and -v, also print the INT highest chain-end scores of reads filled to the end [0]\n");
+    fprintf(fp, "  -c INT     stream each read in chunks of INT anchors through mm_chain_inc_add(), ignoring -b/-B/-t/-j/-V [0]\n");
+    fprintf(fp, "  -v         print the chains of every read\n");
+    fprintf(fp, "  -T FILE    write the binary DP trace to FILE (needs -DMM_CHAIN_TRACE; see trace_decode)\n");
+    fprintf(fp, "  -N INT     trace ring size in events [%d]\n", 1 << 20);
+}
+
+static size_t parse_size(const char *s)
+{
+    char *q;
+    double x = strtod(s, &q);
+    if (*q == 'k' || *q == 'K') x *= 1e3;
+    else if (*q == 'm' || *q == 'M') x *= 1e6;
+    else if (*q == 'g' || *q == 'G') x *= 1e9;
+    return (size_t)(x + .499);
+}
+
+// -c: the chains of every read, as mm_chain_inc_chains() returns them once all its chunks are in
+static void replay_inc(const mm_adump_t *d, uint64_t first, uint64_t n_reads, int64_t chunk, int verbose, uint64_t *n_anchors, uint64_t *n_chains)
+{
+    void *km = km_init2(0, 0);
+    uint64_t i, n_chunks = 0, ns_add = 0, ns_max = 0, ns_chains = 0, t0, t;
+    int k;
+
+    for (i = first; i < first + n_reads; ++i)
+    {
+        mm_adump_rec_t r;
+        mm_chain_inc_t *ic;
+        mm128_t *b;
+        uint64_t *u;
+        int64_t j;
+        int n_u;
+
+        mm_adump_get(d, i, &r);
+        ic = mm_chain_inc_init(km, r.par, 0.0f);
+        for (j = 0; j < r.n; j += chunk)
+        {
+            t0 = mm_time_ns();
+            if (mm_chain_inc_add(ic, r.n - j < chunk ? r.n - j : chunk, r.a + j) < 0)
+            {
+                fprintf(stderr, "[E::%s] read '%s' stopped at anchor %" PRId64 "\n", __func__, r.name, j);
+                break;
+            }
+            t = mm_time_ns() - t0;
+            ns_add += t, ns_max = ns_max > t ? ns_max : t, ++n_chunks;
+        }
+        t0 = mm_time_ns();
+        b = mm_chain_inc_chains(ic, &n_u, &u, km);
+        ns_chains += mm_time_ns() - t0;
+        *n_chains += n_u, *n_anchors += r.n;
+        if (verbose)
+            for (k = 0; k < n_u; ++k)
+                printf("%s\t%d\t%d\t%d\n", r.name, k, (int32_t)(u[k] >> 32), (int32_t)u[k]);
+        kfree(km, u);
+        kfree(km, b);
+        mm_chain_inc_destroy(ic);
+    }
+    km_destroy(km);
+    fprintf(stderr, "[M::%s] chunks=%" PRIu64 " ns/chunk=%.1f max=%" PRIu64 " ns/anchor=%.2f, chains of a read in %.1f ns/anchor\n", __func__,
+            n_chunks, n_chunks ? (double)ns_add / n_chunks : 0.0, ns_max, *n_anchors ? (double)ns_add / *n_anchors : 0.0,
+            *n_anchors ? (double)ns_chains / *n_anchors : 0.0);
+}
+
+// -H: best chain score only; -v prints name, hit, best score, rows filled and the top chain-end scores
+static void replay_screen(const mm_adump_t *d, uint64_t first, uint64_t n_reads, int32_t min_hit, int k, int use_acc, int verbose,
+                          mm_chain_stats_t *cs, uint64_t *n_anchors)
+{
+    void *km = km_init2(0, 0);
+    mm_chain_ws_t *ws = mm_chain_ws_init(km);
+    int32_t *top = (int32_t *)calloc(k > 0 ? k : 1, 4);
+    uint64_t i, n_hits = 0, n_fill = 0, ns = 0, t0;
+    int l;
+
+    ws->view = 1; // borrow the anchors of the dump
+    for (i = first; i < first + n_reads; ++i)
+    {
+        const mm_chain_par_t *cp;
+        mm_adump_rec_t r;
+        mm_chain_screen_t sr;
+        int hit;
+
+        mm_adump_get(d, i, &r);
+        cp = r.par;
+        t0 = mm_time_ns();
+        if (use_acc)
+            hit = mm_chain_screen_acc_st(min_hit, k, top, &sr, cp->max_dist_x, cp->max_dist_y, cp->bw, cp->max_skip, cp->max_iter, cp->min_cnt,
+                                         cp->min_sc, cp->gap_scale, cp->is_cdna, cp->n_segs, r.n, (mm128_t *)r.a, km, ws, cs);
+        else
+            hit = mm_chain_screen_st(min_hit, k, top, &sr, cp->max_dist_x, cp->max_dist_y, cp->bw, cp->max_skip, cp->max_iter, cp->min_cnt, cp->min_sc,
+                                     cp->gap_scale, cp->is_cdna, cp->n_segs, r.n, (mm128_t *)r.a, km, ws, cs);
+        ns += mm_time_ns() - t0;
+        n_hits += hit, n_fill += sr.n_fill, *n_anchors += r.n;
+        if (verbose)
+        {
+            printf("%s\t%d\t%d\t%" PRId64, r.name, hit, sr.best, sr.n_fill);
+            for (l = 0; l < sr.n_top; ++l)
+                printf("%c%d", l ? ',' : '\t', top[l]);
+            printf("\n");
+        }
+    }
+    free(top);
+    mm_chain_ws_destroy(ws);
+    km_destroy(km);
+    fprintf(stderr, "[M::%s] backend=%s reads=%" PRIu64 " hits=%" PRIu64 " anchors=%" PRIu64 " filled=%.1f%% ns/anchor=%.2f\n", __func__,
+            use_acc ? "acc" : mm_chain_backends[0].name, n_reads, n_hits, *n_anchors, *n_anchors ? 100.0 * n_fill / *n_anchors : 0.0,
+            *n_anchors ? (double)ns / *n_anchors : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+    mm_chain_opt_t co;
+    mm_adump_t *d;
+    mm_chain_stats_t cs;
+    mm_chain_job_t *jobs;
+    int c, verbose = 0, n_threads = 1, top_k = 0, batched;
+    int32_t min_hit = -1;
+    int64_t chunk = 0;
+    const char *fn_trace = 0;
+    uint64_t i0, first = 0, n_reads = UINT64_MAX, n_trace = 1 << 20, n_anchors = 0, n_chains = 0, ns = 0, cyc = 0, n_cut = 0, n_cut_reads = 0;
+    int32_t loss_ub = 0;
+    double max_drop = -1.0, drop = 0.0;
+
+    memset(&cs, 0, sizeof(cs));
+    mm_chain_opt_init(&co);
+    co.backend = mm_chain_backends[0].name, co.verbose = 1, co.cs = &cs;
+    while ((c = getopt(argc, argv, "b:B:L:P:s:n:t:j:w:M:a:A:H:K:c:vT:N:V:D:h")) >= 0)
+    {
+        if (c == 'b') co.backend = optarg;
+        else if (c == 'B') co.backend_long = optarg;
+        else if (c == 'L') co.long_min_n = strtoll(optarg, 0, 10);
+        else if (c == 'P')
+        {
+            if (mm_chain_preset(optarg, 0, &co) < 0)
+            {
+                fprintf(stderr, "[E::%s] unknown preset '%s'\n", __func__, optarg);
+                return 1;
+            }
+        }
+        else if (c == 'V') co.shadow_frac = atof(optarg);
+        else if (c == 'D') max_drop = atof(optarg);
+        else if (c == 's') first = strtoull(optarg, 0, 10);
+        else if (c == 'n') n_reads = strtoull(optarg, 0, 10);
+        else if (c == 't') n_threads = atoi(optarg);
+        else if (c == 'j') co.n_block_threads = atoi(optarg);
+        else if (c == 'w') co.wave_min_n = strtoll(optarg, 0, 10);
+        else if (c == 'M') co.mem_cap = parse_size(optarg);
+        else if (c == 'a') co.adapt_min = atoi(optarg);
+        else if (c == 'A') co.adapt_slack = atoi(optarg);
+        else if (c == 'H') min_hit = atoi(optarg);
+        else if (c == 'K') top_k = atoi(optarg);
+        else if (c == 'c') chunk = strtoll(optarg, 0, 10);
+        else if (c == 'v') verbose = 1;
+        else if (c == 'T') fn_trace = optarg;
+        else if (c == 'N') n_trace = strtoull(optarg, 0, 10);
+        else if (c == 'h')
+        {
+            usage(stdout);
+            return 0;
+        }
+        else
+        {
+            usage(stderr);
+            return 1;
+        }
+    }
+    if (optind == argc)
+    {
+        usage(stderr);
+        return 1;
+    }
+    if (mm_chain_backend_pick(co.backend, INT64_MAX) == 0 || (co.backend_long && mm_chain_backend_pick(co.backend_long, INT64_MAX) == 0))
+    {
+        fprintf(stderr, "[E::%s] backend '%s' is unknown or not supported here\n", __func__,
+                mm_chain_backend_pick(co.backend, INT64_MAX) ? co.backend_long : co.backend);
+        return 1;
+    }
+    if ((d = mm_adump_open(argv[optind])) == 0)
+    {
+        fprintf(stderr, "[E::%s] failed to open anchor dump '%s'\n", __func__, argv[optind]);
+        return 1;
+    }
+    if (fn_trace)
+    {
+#ifndef MM_CHAIN_TRACE
+        fprintf(stderr, "[W::%s] built without MM_CHAIN_TRACE; the trace will be empty\n", __func__);
+#endif
+        if (mm_trace_init(n_trace) < 0)
+        {
+            fprintf(stderr, "[E::%s] failed to allocate a trace ring of %" PRIu64 " events\n", __func__, n_trace);
+            return 1;
+        }
+    }
+    if (first > d->n_reads)
+        first = d->n_reads;
+    if (n_reads > d->n_reads - first)
+        n_reads = d->n_reads - first;
+
+    if (min_hit >= 0 && strcmp(co.backend, mm_chain_backends[0].name) != 0 && strcmp(co.backend, "acc") != 0)
+        fprintf(stderr, "[W::%s] -H screens on %s or acc; using %s\n", __func__, mm_chain_backends[0].name, mm_chain_backends[0].name);
+    batched = min_hit < 0 && chunk <= 0;
+    if (min_hit >= 0)
+        replay_screen(d, first, n_reads, min_hit, top_k, strcmp(co.backend, "acc") == 0, verbose, &cs, &n_anchors);
+    else if (chunk > 0)
+        replay_inc(d, first, n_reads, chunk, verbose, &n_anchors, &n_chains);
+    else
+    {
+        jobs = (mm_chain_job_t *)calloc(REPLAY_BATCH, sizeof(mm_chain_job_t));
+        for (i0 = first; i0 < first + n_reads; i0 += REPLAY_BATCH)
+        {
+            int64_t n_jobs = first + n_reads - i0 < REPLAY_BATCH ? first + n_reads - i0 : REPLAY_BATCH, j;
+            uint64_t t0, c0;
+            int k;
+
+            for (j = 0; j < n_jobs; ++j)
+            {
+                mm_adump_rec_t r;
+                mm_adump_get(d, i0 + j, &r);
+                jobs[j].par = r.par, jobs[j].n = r.n, jobs[j].a = r.a;
+                n_anchors += r.n;
+            }
+            t0 = mm_time_ns(), c0 = mm_cycles();
+            mm_chain_batch(&co, n_threads, n_jobs, jobs);
+            cyc += mm_cycles() - c0, ns += mm_time_ns() - t0;
+            for (j = 0; j < n_jobs; ++j)
+            {
+                n_chains += jobs[j].n_u;
+                n_cut += jobs[j].adapt.n_cut, n_cut_reads += jobs[j].adapt.n_cut > 0;
+                loss_ub = loss_ub > jobs[j].adapt.loss_ub ? loss_ub : jobs[j].adapt.loss_ub;
+                if (verbose)
+                {
+                    mm_adump_rec_t r;
+                    mm_adump_get(d, i0 + j, &r);
+                    for (k = 0; k < jobs[j].n_u; ++k)
+                        printf("%s\t%d\t%d\t%d\n", r.name, k, (int32_t)(jobs[j].u[k] >> 32), (int32_t)jobs[j].u[k]);
+                    if (co.adapt_min > 0)
+                        printf("#%s\t%" PRId64 "\t%d\n", r.name, jobs[j].adapt.n_cut, jobs[j].adapt.loss_ub);
+                }
+            }
+            mm_chain_job_free(n_jobs, jobs);
+        }
+        free(jobs);
+    }
+    mm_adump_destroy(d);
+    if (fn_trace)
+    {
+        if (mm_trace_save(fn_trace) < 0)
+            fprintf(stderr, "[E::%s] failed to write the trace to '%s'\n", __func__, fn_trace);
+        mm_trace_destroy();
+    }
+
+    if (chunk > 0 && min_hit < 0)
+        fprintf(stderr, "[M::%s] incremental, %" PRId64 " anchors per chunk: reads=%" PRIu64 " anchors=%" PRIu64 " chains=%" PRIu64 "\n", __func__,
+                chunk, n_reads, n_anchors, n_chains);
+    if (batched)
+        fprintf(stderr, "[M::%s] backend=%s threads=%d reads=%" PRIu64 " anchors=%" PRIu64 " chains=%" PRIu64 " ns/anchor=%.2f cycles/anchor=%.2f\n",
+                __func__, co.backend, n_threads, n_reads, n_anchors, n_chains, n_anchors ? (double)ns / n_anchors : 0.0, n_anchors ? (double)cyc / n_anchors : 0.0);
+    if (co.backend_long && batched)
+        fprintf(stderr, "[M::%s] reads of %" PRId64 " anchors or more on %s\n", __func__, co.long_min_n, co.backend_long);
+    if (co.mem_cap && batched)
+        fprintf(stderr, "[M::%s] working set of a read capped at %zu bytes; largest in windows: %zu\n", __func__, co.mem_cap, co.mem_peak);
+    if (co.adapt_min > 0 && batched)
+        fprintf(stderr, "[M::%s] adaptive window: %" PRIu64 " anchors in %" PRIu64 " reads cut short; best chain score at most %d below the full window\n", __func__,
+                n_cut, n_cut_reads, loss_ub);
+    if (co.n_shadow)
+    {
+        fprintf(stderr, "[M::%s] shadow: %" PRIu64 " reads verified against %s (included in the timings), %" PRIu64 " mismatches\n", __func__,
+                co.n_shadow, mm_chain_backends[0].name, co.n_mismatch);
+        drop = co.shadow_best_ref > 0 ? (double)(co.shadow_best_ref - co.shadow_best) / co.shadow_best_ref : 0.0;
+        fprintf(stderr, "[M::%s] shadow: best chain scores sum to %" PRId64 " against %" PRId64 " (%.1f%% lower); largest drop in a read: %d\n",
+                __func__, co.shadow_best, co.shadow_best_ref, 100.0 * drop, co.shadow_drop);
+    }
+#ifdef MM_CHAIN_STATS
+    mm_chain_stats_print(stderr, "M::main", &cs);
+#endif
+    if (max_drop >= 0.0)
+        return drop > max_drop ? 2 : 0;
+    return co.n_mismatch ? 2 : 0;
+}
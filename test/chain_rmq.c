@@ -0,0 +1,274 @@
+#include <stdlib.h>
+#include <math.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "chain_impl.h"
+#include "chain_trace.h"
+
+// Chaining by range-maximum query, after mg_lchain_rmq() in minimap2's
+// lchain.c, for reads where the max_iter window of mm_chain_dp() either cuts
+// off true predecessors or dominates the runtime.
+//
+// Anchors with a smaller a[].x than the current one and within max_dist_x on
+// the reference are active in a min-tree over their (query position, index)
+// rank; each is keyed by -(f[j] + (x_j + y_j) * gap / 2), so the best entry
+// over the query range [y_i - max_dist_y, y_i] approximates the predecessor
+// with the highest score under a linear gap cost. Unless that pick lies on
+// the diagonal of i, a second pass walks the active anchors within
+// MM_CHAIN_RMQ_INNER_DIST of i, closest query position first, and scores them
+// exactly with max_skip/max_iter as the bounded refinement. O(n log n) per
+// read; the pair score and the tail are those of mm_chain_dp_st(), so u[] and
+// the anchors come out in the same format, though chains may differ: only the
+// one linear-gap pick and the inner pass are scored, where the scan scores its
+// whole window. Reads whose chains have unique anchors come out the same;
+// among repeats and tandem copies the best chain usually does but the
+// secondary ones differ, and in dense off-diagonal noise the pick can lead
+// the best chain through noise anchors and score it lower.
+
+#ifndef MM_CHAIN_RMQ_INNER_DIST
+#define MM_CHAIN_RMQ_INNER_DIST 1000 // max_dist of the refinement pass, as minimap2's --rmq-inner; 0 to disable it
+#endif
+#ifndef MM_CHAIN_RMQ_SIZE_CAP
+#define MM_CHAIN_RMQ_SIZE_CAP 100000 // most anchors kept active, as minimap2's --rmq-size-cap
+#endif
+
+#define MM_CHAIN_RMQ_MAX_N (1 << 30) // the trees index 2 * leaves with int32_t
+
+typedef struct
+{
+    double pri; // -(f[j] + (x_j + y_j) * gap / 2); HUGE_VAL when empty
+    int32_t r;  // rank, -1 when empty
+} rmq_node_t;
+
+typedef struct
+{
+    int32_t sz, n_act; // leaves; active entries
+    rmq_node_t *tr;    // tr[sz + r] is rank r if active; an inner node holds the best entry below it
+} rmq_tree_t;
+
+// lower pri wins; ties go to the higher rank, i.e. the later anchor
+static inline int rmq_lt(const rmq_node_t *x, const rmq_node_t *y)
+{
+    return x->pri < y->pri || (x->pri == y->pri && x->r > y->r);
+}
+
+// activate rank r; ancestors are updated only as far as it wins
+static inline void rmq_insert(rmq_tree_t *t, int32_t r, double pri)
+{
+    int32_t x = t->sz + r;
+    rmq_node_t z;
+    z.pri = pri, z.r = r;
+    t->tr[x] = z, ++t->n_act;
+    for (x >>= 1; x > 0 && rmq_lt(&z, &t->tr[x]); x >>= 1)
+        t->tr[x] = z;
+}
+
+// deactivate rank r; ancestors are recomputed only as far as r was their best
+static inline void rmq_erase(rmq_tree_t *t, int32_t r)
+{
+    int32_t x = t->sz + r;
+    t->tr[x].pri = HUGE_VAL, t->tr[x].r = -1, --t->n_act;
+    for (x >>= 1; x > 0 && t->tr[x].r == r; x >>= 1)
+        t->tr[x] = rmq_lt(&t->tr[x << 1 | 1], &t->tr[x << 1]) ? t->tr[x << 1 | 1] : t->tr[x << 1];
+}
+
+// best active rank in [l, r], or -1
+static inline int32_t rmq_query(const rmq_tree_t *t, int32_t l, int32_t r)
+{
+    const rmq_node_t *best = &t->tr[0]; // never written, so always empty
+    for (l += t->sz, r += t->sz + 1; l < r; l >>= 1, r >>= 1)
+    {
+        if ((l & 1) && rmq_lt(&t->tr[l++], best))
+            best = &t->tr[l - 1];
+        if ((r & 1) && rmq_lt(&t->tr[--r], best))
+            best = &t->tr[r];
+    }
+    return best->r;
+}
+
+// highest active rank <= r, or -1
+static inline int32_t rmq_prev(const rmq_tree_t *t, int32_t r)
+{
+    int32_t x = t->sz + r;
+    if (r < 0)
+        return -1;
+    if (t->tr[x].r >= 0)
+        return r;
+    for (; x > 1; x >>= 1)
+    {
+        if ((x & 1) && t->tr[x - 1].r >= 0)
+        {
+            for (x = x - 1; x < t->sz;)
+                x = t->tr[x << 1 | 1].r >= 0 ? x << 1 | 1 : x << 1;
+            return x - t->sz;
+        }
+    }
+    return -1;
+}
+
+// a query position in the high half of a key, ordered as int32_t
+static inline uint64_t rmq_ykey(int32_t y)
+{
+    return (uint64_t)((uint32_t)y ^ 0x80000000U) << 32;
+}
+
+// the pair score of mm_chain_dp_st(), without f[j]
+static inline int32_t rmq_score(const mm128_t *ai, const mm128_t *aj, float avg_qspan, float gap_scale, int is_cdna)
+{
+    int64_t dr;
+    int32_t dq, gap_cost, sidi = (ai->y & MM_SEED_SEG_MASK) >> MM_SEED_SEG_SHIFT;
+    return mm_chain_pair_sc(ai->x, (int32_t)ai->y, ai->y >> 32 & 0xff, sidi, aj, 0, 0, avg_qspan, gap_scale, &dr, &dq, &gap_cost, is_cdna, 1, 1);
+}
+
+mm128_t *mm_chain_dp_rmq_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                            int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                            mm_chain_stats_t *cs)
+{
+    int32_t *f, *p, *t, *v, *rank, *r_lo, *r_eq, t_tag, max_dist_inner = MM_CHAIN_RMQ_INNER_DIST, sz;
+    int64_t i, i0, j, st = 0, st_in = 0;
+    uint64_t *key, sum_qspan;
+    double pen;
+    float avg_qspan;
+    rmq_tree_t to, ti;
+    uint8_t *buf;
+    MM_CHAIN_STAT_DECL;
+
+    (void)n_segs;
+    if (_u)
+        *_u = 0, *n_u_ = 0;
+    if (n > MM_CHAIN_RMQ_MAX_N)
+        fprintf(stderr, "[E::%s] %lld anchors exceed the 2^30 leaves of the tree\n", __func__, (long long)n);
+    if (n == 0 || a == 0 || n > MM_CHAIN_RMQ_MAX_N)
+    {
+        mm_chain_a_free(km, ws, a);
+        return 0;
+    }
+    sum_qspan = mm_chain_dp_head(km, ws, n, a, &f, &p, &t, &v, &t_tag);
+    avg_qspan = (float)sum_qspan / n;
+    pen = .5 * .01 * avg_qspan * gap_scale; // half the linear gap cost per base
+    if (max_dist_x < bw)
+        max_dist_x = bw;
+    if (max_dist_inner <= 0 || max_dist_inner >= max_dist_x)
+        max_dist_inner = 0;
+    MM_TRACE(MM_TRACE_CALL, n, -1, sum_qspan, 0, 0, 0, -1);
+
+    // rank anchors by (query position, index), the leaf order of both trees
+    for (sz = 1; sz < n; sz <<= 1)
+        ;
+    buf = (uint8_t *)mm_chain_buf(km, ws, MM_CHAIN_WS_RMQ, (size_t)sz * 4 * sizeof(rmq_node_t) + n * 20);
+    to.tr = (rmq_node_t *)buf, ti.tr = to.tr + 2 * sz;
+    key = (uint64_t *)(ti.tr + 2 * sz), rank = (int32_t *)(key + n), r_lo = rank + n, r_eq = r_lo + n;
+    to.sz = ti.sz = sz, to.n_act = ti.n_act = 0;
+    for (i = 0; i < 4 * sz; ++i)
+        to.tr[i].pri = HUGE_VAL, to.tr[i].r = -1;
+    for (i = 0; i < n; ++i)
+        key[i] = rmq_ykey((int32_t)a[i].y) | i;
+    radix_sort_64(key, key + n);
+    // for rank r, r_lo[r] is the first rank at least y_r - max_dist_y and r_eq[r] the first at y_r
+    for (i = 0, j = 0; i < n; ++i)
+    {
+        int64_t y = (int32_t)(key[i] >> 32 ^ 0x80000000U);
+        rank[(uint32_t)key[i]] = i;
+        while (j < i && (int32_t)(key[j] >> 32 ^ 0x80000000U) < y - max_dist_y)
+            ++j;
+        r_lo[i] = j;
+        r_eq[i] = i > 0 && key[i] >> 32 == key[i - 1] >> 32 ? r_eq[i - 1] : i;
+    }
+
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_QSPAN);
+
+    for (i = i0 = 0; i < n; ++i)
+    {
+        int64_t max_j = -1;
+        int32_t q_span = a[i].y >> 32 & 0xff, max_f = q_span, yi = (int32_t)a[i].y, tag = t_tag + (int32_t)i, q;
+
+        // activate anchors left of a[i].x, once they are final
+        if (i0 < i && a[i0].x != a[i].x)
+        {
+            for (j = i0; j < i; ++j)
+            {
+                double pri = -(f[j] + pen * ((double)(int32_t)a[j].x + (int32_t)a[j].y));
+                if (j >= st)
+                    rmq_insert(&to, rank[j], pri);
+                if (max_dist_inner > 0 && j >= st_in)
+                    rmq_insert(&ti, rank[j], pri);
+            }
+            i0 = i;
+        }
+        // and retire those out of range; an anchor in [st, i0) is active
+        while (st < i && (a[i].x >> 32 != a[st].x >> 32 || a[i].x > a[st].x + max_dist_x || to.n_act > MM_CHAIN_RMQ_SIZE_CAP))
+        {
+            if (st < i0)
+                rmq_erase(&to, rank[st]);
+            ++st;
+        }
+        while (max_dist_inner > 0 && st_in < i &&
+               (a[i].x >> 32 != a[st_in].x >> 32 || a[i].x > a[st_in].x + max_dist_inner || ti.n_act > MM_CHAIN_RMQ_SIZE_CAP))
+        {
+            if (st_in < i0)
+                rmq_erase(&ti, rank[st_in]);
+            ++st_in;
+        }
+
+        // ranks past that of i are at a larger y or index, so not active yet
+        q = rmq_query(&to, r_lo[rank[i]], rank[i] - 1);
+        if (q >= 0)
+        {
+            int64_t dr;
+            int32_t sc, dq, width, n_skip = 0, n_iter = 0;
+            j = (uint32_t)key[q];
+            dr = a[i].x - a[j].x, dq = yi - (int32_t)a[j].y;
+            width = dr > dq ? dr - dq : dq - dr;
+            sc = rmq_score(&a[i], &a[j], avg_qspan, gap_scale, is_cdna);
+            MM_CHAIN_STAT_INC(n_pred);
+            MM_TRACE(MM_TRACE_PAIR, i, j, dr + 20, dq, sc, 0, width <= bw && sc + f[j] > max_f ? j : max_j);
+            sc += f[j];
+            if (width <= bw && sc > max_f)
+                max_f = sc, max_j = j;
+
+            // unless the pick continues the diagonal of i, score the nearby anchors exactly
+            if (max_dist_inner > 0 && !(width == 0 && (dq < dr ? dq : dr) <= q_span) && yi > 0)
+            {
+                for (q = rmq_prev(&ti, r_eq[rank[i]] - 1); q >= 0; q = rmq_prev(&ti, q - 1))
+                {
+                    if ((int32_t)(key[q] >> 32 ^ 0x80000000U) < yi - max_dist_inner || ++n_iter > max_iter)
+                        break;
+                    j = (uint32_t)key[q];
+                    dr = a[i].x - a[j].x, dq = yi - (int32_t)a[j].y;
+                    width = dr > dq ? dr - dq : dq - dr;
+                    if (width > bw)
+                        continue;
+                    sc = rmq_score(&a[i], &a[j], avg_qspan, gap_scale, is_cdna);
+                    MM_CHAIN_STAT_INC(n_pred);
+                    MM_TRACE(MM_TRACE_PAIR, i, j, dr + 20, dq, sc, 0, sc + f[j] > max_f ? j : max_j);
+                    sc += f[j];
+                    if (sc > max_f)
+                    {
+                        max_f = sc, max_j = j;
+                        if (n_skip > 0)
+                            --n_skip;
+                    }
+                    else if (t[j] == tag)
+                    {
+                        if (++n_skip > max_skip)
+                        {
+                            MM_CHAIN_STAT_INC(n_skip_exit);
+                            break;
+                        }
+                    }
+                    if (p[j] >= 0)
+                        t[p[j]] = tag;
+                }
+            }
+        }
+        f[i] = max_f, p[i] = max_j;
+        MM_TRACE(MM_TRACE_ROW, i, -1, 0, 0, max_f, 0, max_j);
+        v[i] = max_j >= 0 && v[max_j] > max_f ? v[max_j] : max_f;
+    }
+    mm_chain_buf_free(km, ws, buf);
+
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_FILL);
+    MM_CHAIN_STAT_FLUSH(cs);
+    return mm_chain_dp_tail(min_cnt, min_sc, n, a, f, p, t, v, t_tag, n_u_, _u, km, ws, cs);
+}
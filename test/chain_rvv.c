@@ -0,0 +1,117 @@
+#ifdef MM_CHAIN_RVV
+#include <stdlib.h>
+#include <riscv_vector.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "chain_impl.h"
+#include "chain_trace.h"
+
+#define RVV_MAX_VL 64 // strip length cap; sizes the score buffer of the row reduction
+
+// mm_chain_dp() with the predecessor scores of a row computed in RVV 1.0 strips
+// of up to RVV_MAX_VL anchors, e32/m2, then reduced by mm_chain_row_reduce().
+// Doubles use the same operation sequence as the scalar code, so the scores are
+// bit-identical provided neither side contracts mul+add (-ffp-contract=off).
+mm128_t *mm_chain_dp_rvv_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                            int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                            mm_chain_stats_t *cs)
+{
+    int32_t *f, *p, *t, *v, t_tag, s[RVV_MAX_VL];
+    int64_t i, st = 0;
+    uint64_t sum_qspan;
+    float avg_qspan;
+    double c_avg, c_gs;
+    MM_CHAIN_STAT_DECL;
+
+    if (_u)
+        *_u = 0, *n_u_ = 0;
+    if (n == 0 || a == 0)
+    {
+        mm_chain_a_free(km, ws, a);
+        return 0;
+    }
+    if (!mm_chain_dp_lanes_ok(max_dist_x, n, a))
+        return mm_chain_dp_st(max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n_segs, n, a, n_u_, _u, km, ws,
+                              cs);
+    sum_qspan = mm_chain_dp_head(km, ws, n, a, &f, &p, &t, &v, &t_tag);
+    avg_qspan = (float)sum_qspan / n;
+    c_avg = avg_qspan, c_gs = gap_scale;
+    MM_TRACE(MM_TRACE_CALL, n, -1, sum_qspan, 0, 0, 0, -1);
+
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_QSPAN);
+
+    for (i = 0; i < n; ++i)
+    {
+        uint64_t ri = a[i].x;
+        int64_t max_j = -1, jh;
+        int32_t qi = (int32_t)a[i].y, q_span = a[i].y >> 32 & 0xff;
+        int32_t max_f = q_span, n_skip = 0;
+        int32_t sidi = (a[i].y & MM_SEED_SEG_MASK) >> MM_SEED_SEG_SHIFT;
+        int stop = 0;
+        while (st < i && ri > a[st].x + max_dist_x)
+            ++st;
+        if (i - st > max_iter)
+            st = i - max_iter;
+        for (jh = i - 1; jh >= st && !stop;)
+        {
+            size_t vl = __riscv_vsetvl_e32m2(jh - st + 1 < RVV_MAX_VL ? jh - st + 1 : RVV_MAX_VL);
+            int64_t jl = jh - (int64_t)vl + 1, n_used;
+            const int32_t *aj = (const int32_t *)&a[jl]; // per anchor: x low, x high, y low, y high
+            vint32m2_t x, y, yh, dr, dq, dd, sc, log_dd, c_lin, gap;
+            vbool16_t gt, diff, bonus, use_min;
+            vfloat64m4_t d;
+
+            x = __riscv_vlse32_v_i32m2(aj, sizeof(mm128_t), vl);
+            y = __riscv_vlse32_v_i32m2(aj + 2, sizeof(mm128_t), vl);
+            yh = __riscv_vlse32_v_i32m2(aj + 3, sizeof(mm128_t), vl);
+            dr = __riscv_vadd_vx_i32m2(__riscv_vrsub_vx_i32m2(x, (int32_t)ri, vl), 20, vl);
+            dq = __riscv_vrsub_vx_i32m2(y, qi, vl);
+            gt = __riscv_vmslt_vv_i32m2_b16(dq, dr, vl); // dr > dq
+            dd = __riscv_vmerge_vvm_i32m2(__riscv_vsub_vv_i32m2(dq, dr, vl), __riscv_vsub_vv_i32m2(dr, dq, vl), gt, vl);
+            sc = __riscv_vmin_vx_i32m2(__riscv_vmin_vv_i32m2(dq, dr, vl), q_span, vl);
+
+            // ilog2_32((uint32_t)dd), and 0 for dd == 0
+#ifdef __riscv_zvbb
+            log_dd = __riscv_vreinterpret_v_u32m2_i32m2(__riscv_vrsub_vx_u32m2(__riscv_vclz_v_u32m2(__riscv_vreinterpret_v_i32m2_u32m2(dd), vl), 31, vl));
+#else
+            d = __riscv_vfwcvt_f_xu_v_f64m4(__riscv_vreinterpret_v_i32m2_u32m2(dd), vl); // exact, so the exponent is floor(log2)
+            log_dd = __riscv_vreinterpret_v_u32m2_i32m2(__riscv_vnsrl_wx_u32m2(__riscv_vreinterpret_v_f64m4_u64m4(d), 52, vl));
+            log_dd = __riscv_vsub_vx_i32m2(log_dd, 1023, vl);
+#endif
+            log_dd = __riscv_vmerge_vxm_i32m2(log_dd, 0, __riscv_vmseq_vx_i32m2_b16(dd, 0, vl), vl);
+
+            d = __riscv_vfmul_vf_f64m4(__riscv_vfmul_vf_f64m4(__riscv_vfwcvt_f_x_v_f64m4(dd, vl), .01, vl), c_avg, vl);
+            c_lin = __riscv_vfncvt_rtz_x_f_w_i32m2(d, vl);
+
+            // gap_cost: min(c_lin, log_dd) across segments or, for cDNA, when dr > dq; 0 with a +1 bonus for
+            // overlapping segments; c_lin + log_dd/2 otherwise
+            diff = __riscv_vmsne_vx_i32m2_b16(__riscv_vand_vx_i32m2(__riscv_vsra_vx_i32m2(yh, 16, vl), 0xff, vl), sidi, vl);
+            bonus = __riscv_vmand_mm_b16(diff, __riscv_vmseq_vx_i32m2_b16(dr, 0, vl), vl);
+            use_min = is_cdna ? __riscv_vmor_mm_b16(gt, diff, vl) : diff;
+            gap = __riscv_vadd_vv_i32m2(c_lin, __riscv_vsra_vx_i32m2(log_dd, 1, vl), vl);
+            gap = __riscv_vmerge_vvm_i32m2(gap, __riscv_vmin_vv_i32m2(c_lin, log_dd, vl), use_min, vl);
+            gap = __riscv_vmerge_vxm_i32m2(gap, 0, bonus, vl);
+            sc = __riscv_vadd_vx_i32m2_mu(bonus, sc, sc, 1, vl);
+
+            d = __riscv_vfadd_vf_f64m4(__riscv_vfmul_vf_f64m4(__riscv_vfwcvt_f_x_v_f64m4(gap, vl), c_gs, vl), .499, vl);
+            sc = __riscv_vsub_vv_i32m2(sc, __riscv_vfncvt_rtz_x_f_w_i32m2(d, vl), vl);
+            sc = __riscv_vadd_vv_i32m2(sc, __riscv_vle32_v_i32m2(&f[jl], vl), vl);
+            __riscv_vse32_v_i32m2(s, sc, vl);
+
+            n_used = mm_chain_row_reduce(t_tag + (int32_t)i, jl, jh, s, p, t, max_skip, &max_f, &max_j, &n_skip, &stop);
+            MM_CHAIN_STAT_LADD(n_pred, n_used);
+            jh = jl - 1;
+        }
+        if (stop)
+            MM_CHAIN_STAT_INC(n_skip_exit);
+        f[i] = max_f, p[i] = max_j;
+        v[i] = max_j >= 0 && v[max_j] > max_f ? v[max_j] : max_f;
+        MM_TRACE(MM_TRACE_ROW, i, -1, 0, 0, max_f, 0, max_j);
+    }
+
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_FILL);
+    MM_CHAIN_STAT_FLUSH(cs);
+    return mm_chain_dp_tail(min_cnt, min_sc, n, a, f, p, t, v, t_tag, n_u_, _u, km, ws, cs);
+}
+#endif
@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <string.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "chain_impl.h"
+#include "chain_trace.h"
+
+// Score-only chaining. The fill runs as for mm_chain_dp_st(); instead of the
+// tail, each row whose f[] beats the best so far is checked for min_cnt anchors
+// behind it, walking at most min_cnt - 1 steps of p[]. The row of the highest
+// f[] is the peak the tail backtracks first, and that backtrack never stops
+// early, so the best score found is that of mm_chain_dp()'s best chain whenever
+// that chain is kept. With a threshold, rows are filled in strides and the fill
+// stops after the stride that reaches it.
+
+#ifndef MM_CHAIN_SCREEN_STRIDE
+#define MM_CHAIN_SCREEN_STRIDE 256 // rows filled between threshold checks
+#endif
+
+// the k highest distinct chain-end peaks, as the tail would put them at the head of u[]
+static int screen_top(int min_sc, int64_t n, const int32_t *f, const int32_t *p, int32_t *t, const int32_t *v, int32_t t_tag, int k, int32_t *top,
+                      void *km)
+{
+    int32_t mark_end = t_tag + (int32_t)n;
+    uint64_t *h;
+    int64_t i, j;
+    int l, m = 0;
+
+    h = (uint64_t *)kmalloc(km, k * 8);
+    for (i = 0; i < n; ++i)
+        if (p[i] >= 0)
+            t[p[i]] = mark_end;
+    for (i = 0; i < n; ++i)
+    {
+        uint64_t x;
+        if (t[i] == mark_end || v[i] < min_sc)
+            continue;
+        j = i;
+        while (j >= 0 && f[j] < v[j])
+            j = p[j];
+        if (j < 0)
+            j = i;
+        x = (uint64_t)f[j] << 32 | j;
+        if (m == k && x <= h[m - 1])
+            continue;
+        for (l = 0; l < m && h[l] != x; ++l)
+            ;
+        if (l < m)
+            continue; // another end with the same peak
+        for (l = m < k ? m++ : m - 1; l > 0 && h[l - 1] < x; --l)
+            h[l] = h[l - 1];
+        h[l] = x;
+    }
+    for (l = 0; l < m; ++l)
+        top[l] = h[l] >> 32;
+    kfree(km, h);
+    return m;
+}
+
+int mm_chain_screen_fill(mm_chain_fill_f fill, const mm_chain_fill_t *fl, int32_t min_hit, int k, int32_t *top, mm_chain_screen_t *r, int min_cnt,
+                         int min_sc, int64_t n, mm128_t *a, void *km, mm_chain_ws_t *ws, mm_chain_stats_t *cs)
+{
+    const int32_t *f = fl->f, *p = fl->p;
+    int64_t st = 0, i0, i1, i, j;
+    int32_t best = 0;
+    int c, hit = 0;
+    MM_CHAIN_STAT_DECL;
+
+    for (i0 = 0; i0 < n && !hit; i0 = i1)
+    {
+        i1 = min_hit > 0 && n - i0 > MM_CHAIN_SCREEN_STRIDE ? i0 + MM_CHAIN_SCREEN_STRIDE : n;
+        st = fill(fl, st, i0, i1, cs);
+        for (i = i0; i < i1; ++i)
+        {
+            if (f[i] <= best)
+                continue;
+            for (j = p[i], c = 1; j >= 0 && c < min_cnt; j = p[j])
+                ++c;
+            if (c >= min_cnt)
+                best = f[i];
+        }
+        hit = min_hit > 0 && best >= min_hit;
+    }
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_FILL);
+    r->best = best, r->n_fill = i0, r->n_top = 0;
+    if (k > 0 && i0 == n)
+        r->n_top = screen_top(min_sc, n, f, p, fl->t, fl->v, fl->t_tag, k, top, km);
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_END);
+    MM_CHAIN_STAT_FINISH(cs, n);
+    mm_chain_a_free(km, ws, a);
+    mm_chain_buf_free(km, ws, fl->f);
+    mm_chain_buf_free(km, ws, fl->p);
+    mm_chain_buf_free(km, ws, fl->t);
+    mm_chain_buf_free(km, ws, fl->v);
+    return min_hit > 0 ? hit : best >= min_sc;
+}
+
+int mm_chain_screen_st(int32_t min_hit, int k, int32_t *top, mm_chain_screen_t *r, int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter,
+                       int min_cnt, int min_sc, float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, void *km, mm_chain_ws_t *ws,
+                       mm_chain_stats_t *cs)
+{
+    mm_chain_fill_t fl;
+    int32_t *lut = 0, n_lut;
+    uint64_t sum_qspan;
+    int ret;
+    MM_CHAIN_STAT_TIMER;
+
+    (void)max_dist_y, (void)n_segs;
+    memset(r, 0, sizeof(*r));
+    if (n == 0 || a == 0)
+    {
+        mm_chain_a_free(km, ws, a);
+        return 0;
+    }
+    memset(&fl, 0, sizeof(fl));
+    sum_qspan = mm_chain_dp_head(km, ws, n, a, &fl.f, &fl.p, &fl.t, &fl.v, &fl.t_tag);
+    fl.avg_qspan = (float)sum_qspan / n;
+    MM_TRACE(MM_TRACE_CALL, n, -1, sum_qspan, 0, 0, 0, -1);
+    n_lut = bw < MM_CHAIN_GAP_LUT_MAX ? bw + 1 : MM_CHAIN_GAP_LUT_MAX;
+#ifdef MM_CHAIN_TRACE
+    n_lut = 0;
+#endif
+    if (is_cdna || n_lut <= 0 || n * (n < max_iter ? n : max_iter) / 2 < n_lut)
+        n_lut = 0;
+    else
+        lut = mm_chain_gap_lut(km, ws, n_lut, fl.avg_qspan, gap_scale);
+    fl.max_dist_x = max_dist_x, fl.max_skip = max_skip, fl.max_iter = max_iter, fl.is_cdna = is_cdna;
+    fl.gap_scale = gap_scale, fl.n_lut = n_lut, fl.lut = lut, fl.a = a, fl.ad = 0;
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_QSPAN);
+    ret = mm_chain_screen_fill(mm_chain_fill_st, &fl, min_hit, k, top, r, min_cnt, min_sc, n, a, km, ws, cs);
+    if (lut)
+        mm_chain_buf_free(km, ws, lut);
+    return ret;
+}
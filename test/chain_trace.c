@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chain_trace.h"
+
+mm_trace_ring_t mm_trace_ring;
+
+int mm_trace_init(uint64_t n_rec)
+{
+    uint64_t m = 1;
+    mm_trace_destroy();
+    while (m < n_rec)
+        m <<= 1;
+    if ((mm_trace_ring.r = (mm_trace_rec_t *)malloc(m * sizeof(mm_trace_rec_t))) == 0)
+        return -1;
+    mm_trace_ring.mask = m - 1, mm_trace_ring.n = 0;
+    return 0;
+}
+
+void mm_trace_destroy(void)
+{
+    free(mm_trace_ring.r);
+    memset(&mm_trace_ring, 0, sizeof(mm_trace_ring));
+}
+
+int mm_trace_save(const char *fn)
+{
+    const mm_trace_ring_t *g = &mm_trace_ring;
+    mm_trace_fhdr_t fh;
+    uint64_t size = g->r ? g->mask + 1 : 0, st, l;
+    FILE *fp;
+    int ret = 0;
+
+    if ((fp = fopen(fn, "wb")) == 0)
+        return -1;
+    memset(&fh, 0, sizeof(fh));
+    memcpy(fh.magic, MM_TRACE_MAGIC, 4);
+    fh.rec_size = sizeof(mm_trace_rec_t);
+    fh.n_total = g->n, fh.n_kept = g->n < size ? g->n : size;
+    if (fwrite(&fh, sizeof(fh), 1, fp) != 1)
+        ret = -1;
+    st = g->n - fh.n_kept; // oldest surviving event
+    if (ret == 0 && fh.n_kept > 0)
+    {
+        uint64_t s = st & g->mask;
+        l = size - s < fh.n_kept ? size - s : fh.n_kept; // up to the end of the ring, then wrap
+        if (fwrite(&g->r[s], sizeof(mm_trace_rec_t), l, fp) != l)
+            ret = -1;
+        else if (fh.n_kept > l && fwrite(g->r, sizeof(mm_trace_rec_t), fh.n_kept - l, fp) != fh.n_kept - l)
+            ret = -1;
+    }
+    if (fclose(fp) != 0)
+        ret = -1;
+    return ret;
+}
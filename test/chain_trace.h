@@ -0,0 +1,72 @@
+#ifndef CHAIN_TRACE_H
+#define CHAIN_TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Binary event trace of the chaining DP. With -DMM_CHAIN_TRACE every event is
+// a fixed-size record stored into a preallocated power-of-two ring, keeping the
+// most recent ones; mm_trace_save() writes the ring oldest first and
+// trace_decode turns it back into text. Without MM_CHAIN_TRACE, MM_TRACE()
+// expands to nothing. One ring per process: not thread safe.
+//
+//   file    mm_trace_fhdr_t, n_kept x mm_trace_rec_t (host byte order)
+
+#define MM_TRACE_MAGIC "MMT\1"
+
+#define MM_TRACE_CALL 1 // start of mm_chain_dp(): i = n, dr = sum_qspan
+#define MM_TRACE_PAIR 2 // predecessor j of i scored: sc before adding f[j]; max_j after the update
+#define MM_TRACE_COJ  3 // accelerator CALONEJ result for (i, j), in sc
+#define MM_TRACE_ROW  4 // row i done: sc = f[i], max_j = p[i]
+
+typedef struct
+{
+    int64_t i, j, dr, max_j;
+    int32_t dq, sc, gap_cost;
+    uint32_t ev;
+} mm_trace_rec_t;
+
+typedef struct
+{
+    char magic[4];
+    uint32_t rec_size;
+    uint64_t n_total; // events recorded, including the overwritten ones
+    uint64_t n_kept;
+} mm_trace_fhdr_t;
+
+typedef struct
+{
+    mm_trace_rec_t *r; // 0 when tracing is off
+    uint64_t mask, n;
+} mm_trace_ring_t;
+
+extern mm_trace_ring_t mm_trace_ring;
+
+int mm_trace_init(uint64_t n_rec); // n_rec is rounded up to a power of 2; returns 0 on success
+void mm_trace_destroy(void);
+int mm_trace_save(const char *fn); // returns 0 on success
+
+static inline void mm_trace_put(uint32_t ev, int64_t i, int64_t j, int64_t dr, int32_t dq, int32_t sc, int32_t gap_cost, int64_t max_j)
+{
+    mm_trace_rec_t *r;
+    if (mm_trace_ring.r == 0)
+        return;
+    r = &mm_trace_ring.r[mm_trace_ring.n++ & mm_trace_ring.mask];
+    r->i = i, r->j = j, r->dr = dr, r->max_j = max_j;
+    r->dq = dq, r->sc = sc, r->gap_cost = gap_cost, r->ev = ev;
+}
+
+#ifdef MM_CHAIN_TRACE
+#define MM_TRACE(ev, i, j, dr, dq, sc, gap_cost, max_j) mm_trace_put((ev), (i), (j), (dr), (dq), (sc), (gap_cost), (max_j))
+#else
+#define MM_TRACE(ev, i, j, dr, dq, sc, gap_cost, max_j)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
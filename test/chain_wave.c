@@ -0,0 +1,262 @@
+#include <stdlib.h>
+#include <string.h>
+#ifdef MM_CHAIN_PTHREAD
+#include <pthread.h>
+#endif
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "chain_impl.h"
+#include "chain_trace.h"
+
+// The fill of one read on several threads. A row needs f[] of the row before
+// it from its first predecessor on, so the max/skip scan stays sequential; what
+// it spends most of its time on per predecessor, the gap-penalised pair score,
+// depends on the two anchors alone. Helper threads take stripes of rows in turn
+// and score each row against its nearest MM_CHAIN_WAVE_COLS predecessors into a
+// ring of stripes; the calling thread runs the scan over the stripes in order,
+// reading those scores and computing the rare deeper ones itself. Helpers stay
+// at most a ring ahead; both sides poll briefly, then block. Both run the
+// variant of chain_fill() for the read's is_cdna, segments and gap_scale.
+// Window starts are recomputed per stripe by binary search, which matches the
+// scan's running st only if a[] is sorted by x.
+
+#define MM_CHAIN_WAVE_ROWS 256 // rows of a stripe
+#define MM_CHAIN_WAVE_COLS 64  // predecessors a helper scores per row
+#define MM_CHAIN_WAVE_RING 4   // stripes in flight per helper
+#define MM_CHAIN_WAVE_SPIN 4096 // polls before a waiting thread sleeps on the condition variable
+
+#ifdef MM_CHAIN_PTHREAD
+typedef struct
+{
+    const mm_chain_fill_t *fl;
+    int64_t n, n_stripe, m_ring; // m_ring stripes in the ring
+    int kern;                    // index into the kernel tables, as chain_fill_kern[] in chain.c
+    int32_t *S;                  // m_ring x MM_CHAIN_WAVE_ROWS x MM_CHAIN_WAVE_COLS scores
+    int64_t *ready;              // stripe held by each ring slot, once its scores are in; only grows
+    int64_t next, done;          // next stripe to score; stripes scanned
+    pthread_mutex_t mu;
+    pthread_cond_t cv; // broadcast on every change of ready[] or done
+} wave_shared_t;
+
+// waits until *x >= v: polls first, as the other side is usually a stripe away, then sleeps so as not to take the
+// core from the thread it waits for
+static void wave_wait(wave_shared_t *s, const int64_t *x, int64_t v)
+{
+    int k;
+    for (k = 0; k < MM_CHAIN_WAVE_SPIN; ++k)
+        if (__atomic_load_n(x, __ATOMIC_ACQUIRE) >= v)
+            return;
+    pthread_mutex_lock(&s->mu);
+    while (__atomic_load_n(x, __ATOMIC_ACQUIRE) < v)
+        pthread_cond_wait(&s->cv, &s->mu);
+    pthread_mutex_unlock(&s->mu);
+}
+
+static void wave_post(wave_shared_t *s, int64_t *x, int64_t v)
+{
+    pthread_mutex_lock(&s->mu);
+    __atomic_store_n(x, v, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&s->cv);
+    pthread_mutex_unlock(&s->mu);
+}
+
+// first row from which the predecessor window of row i starts, as the running st of the scan has it for sorted a[]
+static inline int64_t wave_st(const mm_chain_fill_t *fl, int64_t i)
+{
+    const mm128_t *a = fl->a;
+    int64_t lo = 0, hi = i, mid;
+    while (lo < hi)
+    {
+        mid = lo + ((hi - lo) >> 1);
+        if (a[i].x > a[mid].x + fl->max_dist_x)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return i - lo > fl->max_iter ? i - fl->max_iter : lo;
+}
+
+// scores of stripe k, for constant _is_cdna_, _multi_ and _scaled_ as in chain_fill()
+static inline __attribute__((always_inline)) void wave_score(const wave_shared_t *s, int64_t k, const int is_cdna, const int multi, const int scaled)
+{
+    const mm_chain_fill_t *fl = s->fl;
+    const mm128_t *a = fl->a;
+    const int32_t *lut = fl->lut;
+    int32_t n_lut = fl->n_lut;
+    int max_dist_x = fl->max_dist_x, max_iter = fl->max_iter;
+    float avg_qspan = fl->avg_qspan, gap_scale = fl->gap_scale;
+    int32_t *S = &s->S[(k % s->m_ring) * MM_CHAIN_WAVE_ROWS * MM_CHAIN_WAVE_COLS];
+    int64_t i, j, i0 = k * MM_CHAIN_WAVE_ROWS, i1 = i0 + MM_CHAIN_WAVE_ROWS < s->n ? i0 + MM_CHAIN_WAVE_ROWS : s->n, st = wave_st(fl, i0);
+    for (i = i0; i < i1; ++i)
+    {
+        uint64_t ri = a[i].x;
+        int32_t qi = (int32_t)a[i].y, q_span = a[i].y >> 32 & 0xff, sidi = multi ? (a[i].y & MM_SEED_SEG_MASK) >> MM_SEED_SEG_SHIFT : 0;
+        int32_t *Si = &S[(i - i0) * MM_CHAIN_WAVE_COLS], dq, gap_cost;
+        int64_t lo, dr;
+        while (st < i && ri > a[st].x + max_dist_x)
+            ++st;
+        if (i - st > max_iter)
+            st = i - max_iter;
+        lo = i - MM_CHAIN_WAVE_COLS > st ? i - MM_CHAIN_WAVE_COLS : st;
+        for (j = i - 1; j >= lo; --j)
+            Si[i - 1 - j] = mm_chain_pair_sc(ri, qi, q_span, sidi, &a[j], lut, n_lut, avg_qspan, gap_scale, &dr, &dq, &gap_cost, is_cdna, multi, scaled);
+    }
+}
+
+// rows of stripe k, as mm_chain_fill_st() fills them
+static inline __attribute__((always_inline)) int64_t wave_scan(const wave_shared_t *s, int64_t k, int64_t st, mm_chain_stats_t *cs, const int is_cdna,
+                                                               const int multi, const int scaled)
+{
+    const mm_chain_fill_t *fl = s->fl;
+    const mm128_t *a = fl->a;
+    const int32_t *S = &s->S[(k % s->m_ring) * MM_CHAIN_WAVE_ROWS * MM_CHAIN_WAVE_COLS];
+    const int32_t *lut = fl->lut;
+    int32_t *f = fl->f, *p = fl->p, *t = fl->t, *v = fl->v, n_lut = fl->n_lut;
+    int max_dist_x = fl->max_dist_x, max_skip = fl->max_skip, max_iter = fl->max_iter;
+    float avg_qspan = fl->avg_qspan, gap_scale = fl->gap_scale;
+    int64_t i, j, i0 = k * MM_CHAIN_WAVE_ROWS, i1 = i0 + MM_CHAIN_WAVE_ROWS < s->n ? i0 + MM_CHAIN_WAVE_ROWS : s->n;
+    MM_CHAIN_STAT_COUNT;
+
+    for (i = i0; i < i1; ++i)
+    {
+        uint64_t ri = a[i].x;
+        int64_t max_j = -1;
+        int32_t qi = (int32_t)a[i].y, q_span = a[i].y >> 32 & 0xff, sidi = multi ? (a[i].y & MM_SEED_SEG_MASK) >> MM_SEED_SEG_SHIFT : 0;
+        int32_t max_f = q_span, n_skip = 0, tag = fl->t_tag + (int32_t)i;
+        const int32_t *Si = &S[(i - i0) * MM_CHAIN_WAVE_COLS];
+        while (st < i && ri > a[st].x + max_dist_x)
+            ++st;
+        if (i - st > max_iter)
+            st = i - max_iter;
+        for (j = i - 1; j >= st; --j)
+        {
+            int64_t dr;
+            int32_t dq, gap_cost, sc;
+            MM_CHAIN_STAT_INC(n_pred);
+            if (i - 1 - j < MM_CHAIN_WAVE_COLS)
+                sc = Si[i - 1 - j];
+            else
+                sc = mm_chain_pair_sc(ri, qi, q_span, sidi, &a[j], lut, n_lut, avg_qspan, gap_scale, &dr, &dq, &gap_cost, is_cdna, multi, scaled);
+            sc += f[j];
+            if (sc > max_f)
+            {
+                max_f = sc, max_j = j;
+                if (n_skip > 0)
+                    --n_skip;
+            }
+            else if (t[j] == tag)
+            {
+                if (++n_skip > max_skip)
+                {
+                    MM_CHAIN_STAT_INC(n_skip_exit);
+                    break;
+                }
+            }
+            if (p[j] >= 0)
+                t[p[j]] = tag;
+        }
+        f[i] = max_f, p[i] = max_j;
+        v[i] = max_j >= 0 && v[max_j] > max_f ? v[max_j] : max_f; // v[] keeps the peak score up to i; f[] is the score ending at i, not always the peak
+    }
+    MM_CHAIN_STAT_FLUSH(cs);
+    return st;
+}
+
+#define WAVE_KERN(is_cdna, multi, scaled) \
+    static void wave_score_##is_cdna##multi##scaled(const wave_shared_t *s, int64_t k) \
+    { \
+        wave_score(s, k, is_cdna, multi, scaled); \
+    } \
+    static int64_t wave_scan_##is_cdna##multi##scaled(const wave_shared_t *s, int64_t k, int64_t st, mm_chain_stats_t *cs) \
+    { \
+        return wave_scan(s, k, st, cs, is_cdna, multi, scaled); \
+    }
+
+WAVE_KERN(0, 0, 0)
+WAVE_KERN(0, 0, 1)
+WAVE_KERN(0, 1, 0)
+WAVE_KERN(0, 1, 1)
+WAVE_KERN(1, 0, 0)
+WAVE_KERN(1, 0, 1)
+WAVE_KERN(1, 1, 0)
+WAVE_KERN(1, 1, 1)
+
+static void (*const wave_score_kern[8])(const wave_shared_t *, int64_t) = {
+    wave_score_000, wave_score_001, wave_score_010, wave_score_011, wave_score_100, wave_score_101, wave_score_110, wave_score_111,
+};
+
+static int64_t (*const wave_scan_kern[8])(const wave_shared_t *, int64_t, int64_t, mm_chain_stats_t *) = {
+    wave_scan_000, wave_scan_001, wave_scan_010, wave_scan_011, wave_scan_100, wave_scan_101, wave_scan_110, wave_scan_111,
+};
+
+static void *wave_worker(void *data)
+{
+    wave_shared_t *s = (wave_shared_t *)data;
+    int64_t k;
+    while ((k = __sync_fetch_and_add(&s->next, 1)) < s->n_stripe)
+    {
+        wave_wait(s, &s->done, k - s->m_ring + 1); // its slot still holds a stripe the scan needs
+        wave_score_kern[s->kern](s, k);
+        wave_post(s, &s->ready[k % s->m_ring], k);
+    }
+    return 0;
+}
+#endif
+
+void mm_chain_fill_wave(const mm_chain_fill_t *fl, int64_t n, int n_threads, void *km, mm_chain_stats_t *cs)
+{
+#ifdef MM_CHAIN_PTHREAD
+    const mm128_t *a = fl->a;
+    wave_shared_t s;
+    pthread_t *tid;
+    int64_t i, k, st = 0;
+    int h, n_live, multi = 0;
+
+    if (mm_trace_ring.r)
+        n_threads = 1; // keep the events in row order
+    if (n_threads > 1 && n >= 2 * MM_CHAIN_WAVE_ROWS)
+    {
+        for (i = 1; i < n; ++i)
+            if (a[i].x < a[i - 1].x)
+                break;
+        if (i == n)
+        {
+            memset(&s, 0, sizeof(s));
+            for (i = 1; i < n && !multi; ++i) // as mm_chain_fill_st() decides it, over the whole read
+                multi = ((a[i].y ^ a[0].y) & MM_SEED_SEG_MASK) != 0;
+            s.fl = fl, s.n = n, s.n_stripe = (n + MM_CHAIN_WAVE_ROWS - 1) / MM_CHAIN_WAVE_ROWS;
+            s.kern = (fl->is_cdna != 0) << 2 | multi << 1 | (fl->gap_scale != 1.0f);
+            s.m_ring = (int64_t)(n_threads - 1) * MM_CHAIN_WAVE_RING;
+            s.S = (int32_t *)kmalloc(km, s.m_ring * MM_CHAIN_WAVE_ROWS * MM_CHAIN_WAVE_COLS * 4);
+            s.ready = (int64_t *)kmalloc(km, s.m_ring * 8);
+            for (k = 0; k < s.m_ring; ++k)
+                s.ready[k] = -1;
+            pthread_mutex_init(&s.mu, 0);
+            pthread_cond_init(&s.cv, 0);
+            tid = (pthread_t *)malloc((n_threads - 1) * sizeof(pthread_t));
+            for (h = n_live = 0; h < n_threads - 1; ++h) // the helpers share the stripes, so any that start will do
+                if (pthread_create(&tid[n_live], 0, wave_worker, &s) == 0)
+                    ++n_live;
+            for (k = 0; k < s.n_stripe && n_live > 0; ++k)
+            {
+                wave_wait(&s, &s.ready[k % s.m_ring], k);
+                st = wave_scan_kern[s.kern](&s, k, st, cs);
+                wave_post(&s, &s.done, k + 1);
+            }
+            for (h = 0; h < n_live; ++h)
+                pthread_join(tid[h], 0);
+            free(tid);
+            pthread_cond_destroy(&s.cv);
+            pthread_mutex_destroy(&s.mu);
+            kfree(km, s.ready);
+            kfree(km, s.S);
+            if (n_live > 0)
+                return;
+        }
+    }
+#else
+    (void)n_threads, (void)km;
+#endif
+    mm_chain_fill_st(fl, 0, 0, n, cs);
+}
@@ -0,0 +1,255 @@
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <stdlib.h>
+#include <immintrin.h>
+#include "kalloc.h"
+#include "mmpriv.h"
+#include "chain.h"
+#include "chain_impl.h"
+#include "chain_trace.h"
+
+// mm_chain_dp() with a row's predecessor scores computed 8 (AVX2) or 16
+// (AVX-512) at a time in int32 lanes and reduced by mm_chain_row_reduce().
+// The row kernels are compiled with function target attributes and the
+// backends registered behind a CPUID check, so one binary runs on any x86-64.
+// A strip covers predecessors [jl, jh]; lanes past jh are masked off, and a
+// max_skip exit drops the rest of the strip. The double terms repeat the
+// scalar operation sequence, and truncating conversions saturate to INT32_MIN
+// like cvttsd2si does, so output is identical to the scalar code.
+
+int mm_chain_avx2_avail(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+int mm_chain_avx512_avail(void)
+{
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512cd");
+}
+
+// predecessors scored and rows cut short by max_skip
+typedef struct
+{
+    uint64_t n_pred, n_skip_exit;
+} x86_row_stat_t;
+
+typedef void (*x86_row_f)(int64_t i, int64_t st, const mm128_t *a, uint64_t ri, int32_t qi, int32_t q_span, int32_t sidi, int is_cdna,
+                          float avg_qspan, float gap_scale, const int32_t *f, const int32_t *p, int32_t *t, int32_t tag, int max_skip,
+                          int32_t *max_f, int64_t *max_j, int32_t *n_skip, x86_row_stat_t *rs);
+
+static inline __attribute__((target("avx2"))) __m256i avx2_ilog2(__m256i dd)
+{
+    // smear the top bit down and keep only it: a power of two converts to float exactly,
+    // and its biased exponent is the log; 0x80000000 becomes -2^31, still exponent 31
+    __m256i u = dd, e;
+    u = _mm256_or_si256(u, _mm256_srli_epi32(u, 1));
+    u = _mm256_or_si256(u, _mm256_srli_epi32(u, 2));
+    u = _mm256_or_si256(u, _mm256_srli_epi32(u, 4));
+    u = _mm256_or_si256(u, _mm256_srli_epi32(u, 8));
+    u = _mm256_or_si256(u, _mm256_srli_epi32(u, 16));
+    u = _mm256_xor_si256(u, _mm256_srli_epi32(u, 1));
+    e = _mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(u)), 23);
+    e = _mm256_sub_epi32(_mm256_and_si256(e, _mm256_set1_epi32(0xff)), _mm256_set1_epi32(127));
+    return _mm256_andnot_si256(_mm256_cmpeq_epi32(dd, _mm256_setzero_si256()), e); // ilog2 of 0 is 0 here
+}
+
+// (int)(x * c1 * c2) and (int)(x * c1 + c2) for 8 int32 lanes, as two halves of 4 doubles
+static inline __attribute__((target("avx2"))) __m256i avx2_mul2_trunc(__m256i x, double c1, double c2)
+{
+    __m256d lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(x)), hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1));
+    __m256d d1 = _mm256_set1_pd(c1), d2 = _mm256_set1_pd(c2);
+    lo = _mm256_mul_pd(_mm256_mul_pd(lo, d1), d2), hi = _mm256_mul_pd(_mm256_mul_pd(hi, d1), d2);
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(lo)), _mm256_cvttpd_epi32(hi), 1);
+}
+
+static inline __attribute__((target("avx2"))) __m256i avx2_muladd_trunc(__m256i x, double c1, double c2)
+{
+    __m256d lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(x)), hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1));
+    __m256d d1 = _mm256_set1_pd(c1), d2 = _mm256_set1_pd(c2);
+    lo = _mm256_add_pd(_mm256_mul_pd(lo, d1), d2), hi = _mm256_add_pd(_mm256_mul_pd(hi, d1), d2);
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(lo)), _mm256_cvttpd_epi32(hi), 1);
+}
+
+static __attribute__((target("avx2"))) void avx2_row(int64_t i, int64_t st, const mm128_t *a, uint64_t ri, int32_t qi, int32_t q_span,
+                                                     int32_t sidi, int is_cdna, float avg_qspan, float gap_scale, const int32_t *f,
+                                                     const int32_t *p, int32_t *t, int32_t tag, int max_skip, int32_t *max_f, int64_t *max_j,
+                                                     int32_t *n_skip, x86_row_stat_t *rs)
+{
+    const __m256i iota = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), idx = _mm256_slli_epi32(iota, 2); // 4 int32 per mm128_t
+    const __m256i v_ri = _mm256_set1_epi32((int32_t)ri), v_qi = _mm256_set1_epi32(qi), v_qspan = _mm256_set1_epi32(q_span);
+    const __m256i v_sidi = _mm256_set1_epi32(sidi), v_20 = _mm256_set1_epi32(20), v_ff = _mm256_set1_epi32(0xff), zero = _mm256_setzero_si256();
+    int32_t s[8];
+    int64_t jh;
+    int stop = 0;
+
+    for (jh = i - 1; jh >= st && !stop;)
+    {
+        int64_t jl = jh - 7 >= st ? jh - 7 : st, n_used;
+        const int *aj = (const int *)&a[jl];
+        __m256i m = _mm256_cmpgt_epi32(_mm256_set1_epi32((int32_t)(jh - jl + 1)), iota);
+        __m256i x, y, yh, dr, dq, dd, gt, sc, log_dd, c_lin, gap, diff, bonus, use_min;
+
+        x = _mm256_mask_i32gather_epi32(zero, aj, idx, m, 4);
+        y = _mm256_mask_i32gather_epi32(zero, aj + 2, idx, m, 4);
+        yh = _mm256_mask_i32gather_epi32(zero, aj + 3, idx, m, 4);
+        dr = _mm256_add_epi32(_mm256_sub_epi32(v_ri, x), v_20);
+        dq = _mm256_sub_epi32(v_qi, y);
+        gt = _mm256_cmpgt_epi32(dr, dq);
+        dd = _mm256_blendv_epi8(_mm256_sub_epi32(dq, dr), _mm256_sub_epi32(dr, dq), gt);
+        sc = _mm256_min_epi32(_mm256_min_epi32(dq, dr), v_qspan);
+        log_dd = avx2_ilog2(dd);
+        c_lin = avx2_mul2_trunc(dd, .01, avg_qspan);
+
+        diff = _mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_srli_epi32(yh, 16), v_ff), v_sidi), _mm256_set1_epi32(-1));
+        bonus = _mm256_and_si256(diff, _mm256_cmpeq_epi32(dr, zero));
+        use_min = is_cdna ? _mm256_or_si256(gt, diff) : diff;
+        gap = _mm256_add_epi32(c_lin, _mm256_srai_epi32(log_dd, 1));
+        gap = _mm256_blendv_epi8(gap, _mm256_min_epi32(c_lin, log_dd), use_min);
+        gap = _mm256_andnot_si256(bonus, gap);
+        sc = _mm256_sub_epi32(sc, bonus); // +1 where bonus is all ones
+
+        sc = _mm256_sub_epi32(sc, avx2_muladd_trunc(gap, gap_scale, .499));
+        sc = _mm256_add_epi32(sc, _mm256_maskload_epi32(&f[jl], m));
+        _mm256_storeu_si256((__m256i *)s, sc);
+
+        n_used = mm_chain_row_reduce(tag, jl, jh, s, p, t, max_skip, max_f, max_j, n_skip, &stop);
+        rs->n_pred += n_used;
+        jh = jl - 1;
+    }
+    rs->n_skip_exit += stop;
+}
+
+static inline __attribute__((target("avx512f,avx512cd"))) __m512i avx512_mul2_trunc(__m512i x, double c1, double c2)
+{
+    __m512d lo = _mm512_cvtepi32_pd(_mm512_castsi512_si256(x)), hi = _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(x, 1));
+    __m512d d1 = _mm512_set1_pd(c1), d2 = _mm512_set1_pd(c2);
+    lo = _mm512_mul_pd(_mm512_mul_pd(lo, d1), d2), hi = _mm512_mul_pd(_mm512_mul_pd(hi, d1), d2);
+    return _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvttpd_epi32(lo)), _mm512_cvttpd_epi32(hi), 1);
+}
+
+static inline __attribute__((target("avx512f,avx512cd"))) __m512i avx512_muladd_trunc(__m512i x, double c1, double c2)
+{
+    __m512d lo = _mm512_cvtepi32_pd(_mm512_castsi512_si256(x)), hi = _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(x, 1));
+    __m512d d1 = _mm512_set1_pd(c1), d2 = _mm512_set1_pd(c2);
+    lo = _mm512_add_pd(_mm512_mul_pd(lo, d1), d2), hi = _mm512_add_pd(_mm512_mul_pd(hi, d1), d2);
+    return _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvttpd_epi32(lo)), _mm512_cvttpd_epi32(hi), 1);
+}
+
+static __attribute__((target("avx512f,avx512cd"))) void avx512_row(int64_t i, int64_t st, const mm128_t *a, uint64_t ri, int32_t qi,
+                                                                   int32_t q_span, int32_t sidi, int is_cdna, float avg_qspan, float gap_scale,
+                                                                   const int32_t *f, const int32_t *p, int32_t *t, int32_t tag, int max_skip,
+                                                                   int32_t *max_f, int64_t *max_j, int32_t *n_skip, x86_row_stat_t *rs)
+{
+    const __m512i idx = _mm512_slli_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), 2);
+    const __m512i v_ri = _mm512_set1_epi32((int32_t)ri), v_qi = _mm512_set1_epi32(qi), v_qspan = _mm512_set1_epi32(q_span);
+    const __m512i v_sidi = _mm512_set1_epi32(sidi), v_20 = _mm512_set1_epi32(20), v_ff = _mm512_set1_epi32(0xff), v_31 = _mm512_set1_epi32(31);
+    const __m512i zero = _mm512_setzero_si512(), one = _mm512_set1_epi32(1);
+    int32_t s[16];
+    int64_t jh;
+    int stop = 0;
+
+    for (jh = i - 1; jh >= st && !stop;)
+    {
+        int64_t jl = jh - 15 >= st ? jh - 15 : st, n_used;
+        const int *aj = (const int *)&a[jl];
+        __mmask16 m = (__mmask16)((1u << (jh - jl + 1)) - 1), gt, diff, bonus, use_min;
+        __m512i x, y, yh, dr, dq, dd, sc, log_dd, c_lin, gap;
+
+        x = _mm512_mask_i32gather_epi32(zero, m, idx, aj, 4);
+        y = _mm512_mask_i32gather_epi32(zero, m, idx, aj + 2, 4);
+        yh = _mm512_mask_i32gather_epi32(zero, m, idx, aj + 3, 4);
+        dr = _mm512_add_epi32(_mm512_sub_epi32(v_ri, x), v_20);
+        dq = _mm512_sub_epi32(v_qi, y);
+        gt = _mm512_cmpgt_epi32_mask(dr, dq);
+        dd = _mm512_mask_blend_epi32(gt, _mm512_sub_epi32(dq, dr), _mm512_sub_epi32(dr, dq));
+        sc = _mm512_min_epi32(_mm512_min_epi32(dq, dr), v_qspan);
+        log_dd = _mm512_maskz_sub_epi32(_mm512_test_epi32_mask(dd, dd), v_31, _mm512_lzcnt_epi32(dd)); // ilog2 of 0 is 0 here
+        c_lin = avx512_mul2_trunc(dd, .01, avg_qspan);
+
+        diff = _mm512_cmpneq_epi32_mask(_mm512_and_si512(_mm512_srli_epi32(yh, 16), v_ff), v_sidi);
+        bonus = diff & _mm512_cmpeq_epi32_mask(dr, zero);
+        use_min = is_cdna ? gt | diff : diff;
+        gap = _mm512_add_epi32(c_lin, _mm512_srai_epi32(log_dd, 1));
+        gap = _mm512_mask_blend_epi32(use_min, gap, _mm512_min_epi32(c_lin, log_dd));
+        gap = _mm512_maskz_mov_epi32((__mmask16)~bonus, gap);
+        sc = _mm512_mask_add_epi32(sc, bonus, sc, one);
+
+        sc = _mm512_sub_epi32(sc, avx512_muladd_trunc(gap, gap_scale, .499));
+        sc = _mm512_add_epi32(sc, _mm512_maskz_loadu_epi32(m, &f[jl]));
+        _mm512_storeu_si512(s, sc);
+
+        n_used = mm_chain_row_reduce(tag, jl, jh, s, p, t, max_skip, max_f, max_j, n_skip, &stop);
+        rs->n_pred += n_used;
+        jh = jl - 1;
+    }
+    rs->n_skip_exit += stop;
+}
+
+static mm128_t *x86_chain_dp(x86_row_f row, int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc,
+                             float gap_scale, int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km,
+                             mm_chain_ws_t *ws, mm_chain_stats_t *cs)
+{
+    int32_t *f, *p, *t, *v, t_tag;
+    int64_t i, st = 0;
+    uint64_t sum_qspan;
+    float avg_qspan;
+    x86_row_stat_t rs = {0, 0};
+    MM_CHAIN_STAT_DECL;
+
+    if (_u)
+        *_u = 0, *n_u_ = 0;
+    if (n == 0 || a == 0)
+    {
+        mm_chain_a_free(km, ws, a);
+        return 0;
+    }
+    if (!mm_chain_dp_lanes_ok(max_dist_x, n, a))
+        return mm_chain_dp_st(max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n_segs, n, a, n_u_, _u, km, ws,
+                              cs);
+    sum_qspan = mm_chain_dp_head(km, ws, n, a, &f, &p, &t, &v, &t_tag);
+    avg_qspan = (float)sum_qspan / n;
+    MM_TRACE(MM_TRACE_CALL, n, -1, sum_qspan, 0, 0, 0, -1);
+
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_QSPAN);
+
+    for (i = 0; i < n; ++i)
+    {
+        uint64_t ri = a[i].x;
+        int64_t max_j = -1;
+        int32_t qi = (int32_t)a[i].y, q_span = a[i].y >> 32 & 0xff;
+        int32_t max_f = q_span, n_skip = 0;
+        int32_t sidi = (a[i].y & MM_SEED_SEG_MASK) >> MM_SEED_SEG_SHIFT;
+        while (st < i && ri > a[st].x + max_dist_x)
+            ++st;
+        if (i - st > max_iter)
+            st = i - max_iter;
+        if (st < i)
+            row(i, st, a, ri, qi, q_span, sidi, is_cdna, avg_qspan, gap_scale, f, p, t, t_tag + (int32_t)i, max_skip, &max_f, &max_j, &n_skip,
+                &rs);
+        f[i] = max_f, p[i] = max_j;
+        v[i] = max_j >= 0 && v[max_j] > max_f ? v[max_j] : max_f;
+        MM_TRACE(MM_TRACE_ROW, i, -1, 0, 0, max_f, 0, max_j);
+    }
+
+    MM_CHAIN_STAT_LADD(n_pred, rs.n_pred);
+    MM_CHAIN_STAT_LADD(n_skip_exit, rs.n_skip_exit);
+    MM_CHAIN_STAT_PHASE(cs, MM_CHAIN_PH_FILL);
+    MM_CHAIN_STAT_FLUSH(cs);
+    return mm_chain_dp_tail(min_cnt, min_sc, n, a, f, p, t, v, t_tag, n_u_, _u, km, ws, cs);
+}
+
+mm128_t *mm_chain_dp_avx2_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                             int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                             mm_chain_stats_t *cs)
+{
+    return x86_chain_dp(avx2_row, max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n_segs, n, a, n_u_, _u, km,
+                        ws, cs);
+}
+
+mm128_t *mm_chain_dp_avx512_st(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float gap_scale,
+                               int is_cdna, int n_segs, int64_t n, mm128_t *a, int *n_u_, uint64_t **_u, void *km, mm_chain_ws_t *ws,
+                               mm_chain_stats_t *cs)
+{
+    return x86_chain_dp(avx512_row, max_dist_x, max_dist_y, bw, max_skip, max_iter, min_cnt, min_sc, gap_scale, is_cdna, n_segs, n, a, n_u_, _u,
+                        km, ws, cs);
+}
+#endif
@@ -0,0 +1,37 @@
+#ifndef CYCLES_H
+#define CYCLES_H
+
+#include <stdint.h>
+#include <time.h>
+
+static inline uint64_t mm_time_ns(void);
+
+// cycle counter of the core we run on: rdcycle on RISC-V, the TSC on x86, nanoseconds elsewhere
+static inline uint64_t mm_cycles(void)
+{
+#if defined(__riscv)
+    uint64_t c;
+    asm volatile("rdcycle %0" : "=r"(c));
+    return c;
+#elif defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return (uint64_t)hi << 32 | lo;
+#else
+    return mm_time_ns();
+#endif
+}
+
+// wall clock in ns; 0 where the C library has no monotonic clock (bare-metal HTIF)
+static inline uint64_t mm_time_ns(void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+#endif
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "anchor_gen.h"
+#include "anchors.h"
+#include "adump.h"
+
+static void usage(FILE *fp, const mm_agen_opt_t *o)
+{
+    fprintf(fp, "Usage: gen_anchors [options] > anchors.txt\n");
+    fprintf(fp, "  -r INT     number of reads [1]\n");
+    fprintf(fp, "  -n INT     anchors per read [%ld]\n", (long)o->n);
+    fprintf(fp, "  -N INT     draw anchors per read uniformly from [INT, -n] [off]\n");
+    fprintf(fp, "  -d FLOAT   collinear anchors per kb of query [%g]\n", o->density);
+    fprintf(fp, "  -c INT     collinear chains per read [%d]\n", o->n_chains);
+    fprintf(fp, "  -e FLOAT   fraction of random (noise) anchors [%g]\n", o->noise_frac);
+    fprintf(fp, "  -p FLOAT   fraction of chain anchors copied to other loci [%g]\n", o->rep_frac);
+    fprintf(fp, "  -t FLOAT   fraction of chain anchors in tandem copies [%g]\n", o->tandem_frac);
+    fprintf(fp, "  -T INT     tandem period [%d]\n", o->tandem_period);
+    fprintf(fp, "  -C INT     tandem copies per run [%d]\n", o->tandem_copies);
+    fprintf(fp, "  -s FLOAT   fraction of chains on the reverse strand [%g]\n", o->rev_frac);
+    fprintf(fp, "  -S INT     query segments [%d]\n", o->n_segs);
+    fprintf(fp, "  -m INT     reference sequences [%d]\n", o->n_targets);
+    fprintf(fp, "  -L INT     reference sequence length [%ld]\n", (long)o->target_len);
+    fprintf(fp, "  -k INT     k-mer span [%d]\n", o->q_span);
+    fprintf(fp, "  -i FLOAT   per-anchor indel probability [%g]\n", o->indel_rate);
+    fprintf(fp, "  -z INT     random seed [%lu]\n", (unsigned long)o->seed);
+    fprintf(fp, "  -o FILE    write a binary anchor dump (with default chaining parameters) instead of text\n");
+}
+
+int main(int argc, char *argv[])
+{
+    mm_agen_opt_t opt;
+    mm_chain_par_t cp;
+    mm_adump_w_t *w = 0;
+    int c, min_n_set = 0;
+    long n_reads = 1, r;
+    const char *fn_dump = 0;
+
+    mm_agen_opt_init(&opt);
+    while ((c = getopt(argc, argv, "r:n:N:d:c:e:p:t:T:C:s:S:m:L:k:i:z:o:h")) >= 0)
+    {
+        if (c == 'r') n_reads = atol(optarg);
+        else if (c == 'n') opt.n = atol(optarg);
+        else if (c == 'N') opt.min_n = atol(optarg), min_n_set = 1;
+        else if (c == 'd') opt.density = atof(optarg);
+        else if (c == 'c') opt.n_chains = atoi(optarg);
+        else if (c == 'e') opt.noise_frac = atof(optarg);
+        else if (c == 'p') opt.rep_frac = atof(optarg);
+        else if (c == 't') opt.tandem_frac = atof(optarg);
+        else if (c == 'T') opt.tandem_period = atoi(optarg);
+        else if (c == 'C') opt.tandem_copies = atoi(optarg);
+        else if (c == 's') opt.rev_frac = atof(optarg);
+        else if (c == 'S') opt.n_segs = atoi(optarg);
+        else if (c == 'm') opt.n_targets = atoi(optarg);
+        else if (c == 'L') opt.target_len = atol(optarg);
+        else if (c == 'k') opt.q_span = atoi(optarg);
+        else if (c == 'i') opt.indel_rate = atof(optarg);
+        else if (c == 'z') opt.seed = strtoull(optarg, 0, 10);
+        else if (c == 'o') fn_dump = optarg;
+        else if (c == 'h')
+        {
+            usage(stdout, &opt);
+            return 0;
+        }
+        else
+        {
+            usage(stderr, &opt);
+            return 1;
+        }
+    }
+    if (!min_n_set)
+        opt.min_n = opt.n;
+    mm_chain_par_init(&cp);
+    cp.n_segs = opt.n_segs;
+    if (fn_dump && (w = mm_adump_create(fn_dump)) == 0)
+    {
+        fprintf(stderr, "[E::%s] failed to create '%s'\n", __func__, fn_dump);
+        return 1;
+    }
+    for (r = 0; r < n_reads; ++r)
+    {
+        char name[32];
+        int64_t n;
+        mm128_t *a = mm_agen_read(&opt, r, &n);
+        snprintf(name, sizeof(name), "read%ld", r);
+        if (w)
+            mm_adump_write(w, name, &cp, n, a);
+        else
+            mm_anchors_write1(stdout, name, n, a);
+        free(a);
+    }
+    if (w && mm_adump_close(w) < 0)
+    {
+        fprintf(stderr, "[E::%s] failed to write '%s'\n", __func__, fn_dump);
+        return 1;
+    }
+    return 0;
+}
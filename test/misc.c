@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include "mmpriv.h"
+
+#define RS_MIN_SIZE 64
+#define RS_MAX_BITS 8
+
+typedef struct
+{
+    mm128_t *b, *e;
+} rsbucket_128x_t;
+
+typedef struct
+{
+    uint64_t *b, *e;
+} rsbucket_64_t;
+
+static void rs_insertsort_128x(mm128_t *beg, mm128_t *end)
+{
+    mm128_t *i;
+    for (i = beg + 1; i < end; ++i)
+    {
+        if (i->x < (i - 1)->x)
+        {
+            mm128_t *j, tmp = *i;
+            for (j = i; j > beg && tmp.x < (j - 1)->x; --j)
+                *j = *(j - 1);
+            *j = tmp;
+        }
+    }
+}
+
+static void rs_sort_128x(mm128_t *beg, mm128_t *end, int n_bits, int s)
+{
+    mm128_t *i;
+    int size = 1 << n_bits, m = size - 1;
+    rsbucket_128x_t *k, b[1 << RS_MAX_BITS], *be = b + size;
+    assert(n_bits <= RS_MAX_BITS);
+    for (k = b; k != be; ++k)
+        k->b = k->e = beg;
+    for (i = beg; i != end; ++i)
+        ++b[i->x >> s & m].e;
+    for (k = b + 1; k != be; ++k)
+        k->e += (k - 1)->e - beg, k->b = (k - 1)->e;
+    for (k = b; k != be;)
+    {
+        if (k->b != k->e)
+        {
+            rsbucket_128x_t *l;
+            if ((l = b + (k->b->x >> s & m)) != k)
+            {
+                mm128_t tmp = *k->b, swap;
+                do
+                {
+                    swap = tmp;
+                    tmp = *l->b;
+                    *l->b++ = swap;
+                    l = b + (tmp.x >> s & m);
+                } while (l != k);
+                *k->b++ = tmp;
+            }
+            else
+                ++k->b;
+        }
+        else
+            ++k;
+    }
+    for (b->b = beg, k = b + 1; k != be; ++k)
+        k->b = (k - 1)->e;
+    if (s)
+    {
+        s = s > n_bits ? s - n_bits : 0;
+        for (k = b; k != be; ++k)
+            if (k->e - k->b > RS_MIN_SIZE)
+                rs_sort_128x(k->b, k->e, n_bits, s);
+            else if (k->e - k->b > 1)
+                rs_insertsort_128x(k->b, k->e);
+    }
+}
+
+void radix_sort_128x(mm128_t *beg, mm128_t *end)
+{
+    if (end - beg <= RS_MIN_SIZE)
+        rs_insertsort_128x(beg, end);
+    else
+        rs_sort_128x(beg, end, RS_MAX_BITS, (sizeof(uint64_t) - 1) * RS_MAX_BITS);
+}
+
+static void rs_insertsort_64(uint64_t *beg, uint64_t *end)
+{
+    uint64_t *i;
+    for (i = beg + 1; i < end; ++i)
+    {
+        if (*i < *(i - 1))
+        {
+            uint64_t *j, tmp = *i;
+            for (j = i; j > beg && tmp < *(j - 1); --j)
+                *j = *(j - 1);
+            *j = tmp;
+        }
+    }
+}
+
+static void rs_sort_64(uint64_t *beg, uint64_t *end, int n_bits, int s)
+{
+    uint64_t *i;
+    int size = 1 << n_bits, m = size - 1;
+    rsbucket_64_t *k, b[1 << RS_MAX_BITS], *be = b + size;
+    assert(n_bits <= RS_MAX_BITS);
+    for (k = b; k != be; ++k)
+        k->b = k->e = beg;
+    for (i = beg; i != end; ++i)
+        ++b[*i >> s & m].e;
+    for (k = b + 1; k != be; ++k)
+        k->e += (k - 1)->e - beg, k->b = (k - 1)->e;
+    for (k = b; k != be;)
+    {
+        if (k->b != k->e)
+        {
+            rsbucket_64_t *l;
+            if ((l = b + (*k->b >> s & m)) != k)
+            {
+                uint64_t tmp = *k->b, swap;
+                do
+                {
+                    swap = tmp;
+                    tmp = *l->b;
+                    *l->b++ = swap;
+                    l = b + (tmp >> s & m);
+                } while (l != k);
+                *k->b++ = tmp;
+            }
+            else
+                ++k->b;
+        }
+        else
+            ++k;
+    }
+    for (b->b = beg, k = b + 1; k != be; ++k)
+        k->b = (k - 1)->e;
+    if (s)
+    {
+        s = s > n_bits ? s - n_bits : 0;
+        for (k = b; k != be; ++k)
+            if (k->e - k->b > RS_MIN_SIZE)
+                rs_sort_64(k->b, k->e, n_bits, s);
+            else if (k->e - k->b > 1)
+                rs_insertsort_64(k->b, k->e);
+    }
+}
+
+void radix_sort_64(uint64_t *beg, uint64_t *end)
+{
+    if (end - beg <= RS_MIN_SIZE)
+        rs_insertsort_64(beg, end);
+    else
+        rs_sort_64(beg, end, RS_MAX_BITS, (sizeof(uint64_t) - 1) * RS_MAX_BITS);
+}
@@ -16,6 +16,23 @@
 #define CUSTOM_2 0b1011011
 #define CUSTOM_3 0b1111011
 
+#ifdef ROCC_EMU
+// Host build: every custom instruction becomes a call into the software model
+#include "rocc_emu.h"
+
+#define ROCC_INSTRUCTION_DSS(X, rd, rs1, rs2, funct) { rd = rocc_emu_exec(X, funct, (uint64_t)(rs1), (uint64_t)(rs2)); }
+#define ROCC_INSTRUCTION_DS(X, rd, rs1, funct)       { rd = rocc_emu_exec(X, funct, (uint64_t)(rs1), 0); }
+#define ROCC_INSTRUCTION_D(X, rd, funct)             { rd = rocc_emu_exec(X, funct, 0, 0); }
+#define ROCC_INSTRUCTION_SS(X, rs1, rs2, funct)      { rocc_emu_exec(X, funct, (uint64_t)(rs1), (uint64_t)(rs2)); }
+#define ROCC_INSTRUCTION_S(X, rs1, funct)            { rocc_emu_exec(X, funct, (uint64_t)(rs1), 0); }
+#define ROCC_INSTRUCTION(X, funct)                   { rocc_emu_exec(X, funct, 0, 0); }
+
+#define ROCC_FENCE() asm volatile("" ::: "memory")
+
+#else
+
+#define ROCC_FENCE() asm volatile("fence")
+
 #define CUSTOMX(X, xd, xs1, xs2, rd, rs1, rs2, funct) \
   CUSTOMX_OPCODE(X)                     |             \
   (rd                 << (7))           |             \
@@ -95,4 +112,6 @@
         ".word " STR(CUSTOMX(X, 0, 0, 0, rd, rs1, rs2, funct)) "\n\t" ); \
   }
 
+#endif  // ROCC_EMU
+
 #endif  // SRC_MAIN_C_ACCUMULATOR_H
@@ -0,0 +1,63 @@
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "rocc_emu.h"
+
+static const char *emu_fn_name[ACC_N_FN] = {"QSPAN", "LPARAMS", "CALONEJ"};
+
+static acc_cfg_t emu_cfg = {2, 2}; // L1 hit latency; RoCC queue hand-off
+static acc_state_t emu_state = {~0ULL, 0, {0}};
+static acc_stats_t emu_stats;
+
+// the host build passes real pointers, so the accelerator reads straight from process memory
+static uint64_t emu_load64(void *data, uint64_t addr)
+{
+    (void)data;
+    return *(const uint64_t *)(uintptr_t)addr;
+}
+
+uint64_t rocc_emu_exec(int x, unsigned funct, uint64_t rs1, uint64_t rs2)
+{
+    uint64_t rd;
+    int err;
+    if (x != 0)
+    {
+        fprintf(stderr, "[E::%s] no accelerator on custom%d\n", __func__, x);
+        abort();
+    }
+    rd = acc_exec(&emu_state, &emu_stats, &emu_cfg, funct, rs1, rs2, emu_load64, 0, &err);
+    if (err)
+    {
+        fprintf(stderr, "[E::%s] unimplemented funct %u\n", __func__, funct);
+        abort();
+    }
+    return rd;
+}
+
+void rocc_emu_config(const acc_cfg_t *cfg)
+{
+    emu_cfg = *cfg;
+}
+
+const acc_stats_t *rocc_emu_stats(void)
+{
+    return &emu_stats;
+}
+
+void rocc_emu_reset_stats(void)
+{
+    memset(&emu_stats, 0, sizeof(acc_stats_t));
+}
+
+void rocc_emu_print_stats(FILE *fp)
+{
+    int k;
+    uint64_t n = 0;
+    for (k = 0; k < ACC_N_FN; ++k)
+    {
+        fprintf(fp, "[rocc_emu] %-8s commands=%" PRIu64 " cycles=%" PRIu64 "\n", emu_fn_name[k], emu_stats.n_cmd[k], emu_stats.cycles[k]);
+        n += emu_stats.n_cmd[k];
+    }
+    fprintf(fp, "[rocc_emu] total    commands=%" PRIu64 " loads=%" PRIu64 " bytes=%" PRIu64 " stall_cycles=%" PRIu64 "\n", n, emu_stats.n_load,
+            emu_stats.bytes, emu_stats.stall);
+}
@@ -0,0 +1,26 @@
+#ifndef ROCC_EMU_H
+#define ROCC_EMU_H
+
+// Host-side stand-in for the custom0 RoCC accelerator, selected with -DROCC_EMU.
+// rocc.h routes every ROCC_INSTRUCTION_* through rocc_emu_exec().
+
+#include <stdio.h>
+#include <stdint.h>
+#include "acc_model.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t rocc_emu_exec(int x, unsigned funct, uint64_t rs1, uint64_t rs2);
+
+void rocc_emu_config(const acc_cfg_t *cfg);
+const acc_stats_t *rocc_emu_stats(void);
+void rocc_emu_reset_stats(void);
+void rocc_emu_print_stats(FILE *fp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
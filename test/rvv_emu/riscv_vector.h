@@ -0,0 +1,220 @@
+#ifndef RVV_EMU_RISCV_VECTOR_H
+#define RVV_EMU_RISCV_VECTOR_H
+
+// Host stand-in for the RVV 1.0 intrinsics chain_rvv.c uses, element by element
+// in plain C, so that the strip logic of the "rvv" backend can be checked
+// against the scalar reference without a V core (cmake -D MM_CHAIN_RVV_EMU=ON).
+// It follows the intrinsics' semantics, not their codegen: it says nothing
+// about the compiler, the ISA or speed. VLMAX at e32/m2 is RVV_EMU_VLMAX
+// (VLEN / 16; 8 for VLEN = 128).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef RVV_EMU_VLMAX
+#define RVV_EMU_VLMAX 8
+#endif
+
+typedef struct { int32_t e[RVV_EMU_VLMAX]; } vint32m2_t;
+typedef struct { uint32_t e[RVV_EMU_VLMAX]; } vuint32m2_t;
+typedef struct { double e[RVV_EMU_VLMAX]; } vfloat64m4_t;
+typedef struct { uint64_t e[RVV_EMU_VLMAX]; } vuint64m4_t;
+typedef struct { int e[RVV_EMU_VLMAX]; } vbool16_t;
+
+#define RVV_EMU_FOR(k) for (size_t k = 0; k < vl; ++k)
+
+static inline size_t __riscv_vsetvl_e32m2(size_t avl)
+{
+    return avl < RVV_EMU_VLMAX ? avl : RVV_EMU_VLMAX;
+}
+
+static inline vint32m2_t __riscv_vlse32_v_i32m2(const int32_t *p, ptrdiff_t stride, size_t vl)
+{
+    vint32m2_t r;
+    RVV_EMU_FOR(k) memcpy(&r.e[k], (const char *)p + (ptrdiff_t)k * stride, 4);
+    return r;
+}
+
+static inline vint32m2_t __riscv_vle32_v_i32m2(const int32_t *p, size_t vl)
+{
+    vint32m2_t r;
+    RVV_EMU_FOR(k) r.e[k] = p[k];
+    return r;
+}
+
+static inline void __riscv_vse32_v_i32m2(int32_t *p, vint32m2_t a, size_t vl)
+{
+    RVV_EMU_FOR(k) p[k] = a.e[k];
+}
+
+// integer ops wrap, as the vector unit does
+static inline vint32m2_t __riscv_vadd_vv_i32m2(vint32m2_t a, vint32m2_t b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] = (int32_t)((uint32_t)a.e[k] + (uint32_t)b.e[k]);
+    return a;
+}
+
+static inline vint32m2_t __riscv_vadd_vx_i32m2(vint32m2_t a, int32_t b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] = (int32_t)((uint32_t)a.e[k] + (uint32_t)b);
+    return a;
+}
+
+static inline vint32m2_t __riscv_vadd_vx_i32m2_mu(vbool16_t m, vint32m2_t off, vint32m2_t a, int32_t b, size_t vl)
+{
+    RVV_EMU_FOR(k) off.e[k] = m.e[k] ? (int32_t)((uint32_t)a.e[k] + (uint32_t)b) : off.e[k];
+    return off;
+}
+
+static inline vint32m2_t __riscv_vsub_vv_i32m2(vint32m2_t a, vint32m2_t b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] = (int32_t)((uint32_t)a.e[k] - (uint32_t)b.e[k]);
+    return a;
+}
+
+static inline vint32m2_t __riscv_vsub_vx_i32m2(vint32m2_t a, int32_t b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] = (int32_t)((uint32_t)a.e[k] - (uint32_t)b);
+    return a;
+}
+
+static inline vint32m2_t __riscv_vrsub_vx_i32m2(vint32m2_t a, int32_t b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] = (int32_t)((uint32_t)b - (uint32_t)a.e[k]);
+    return a;
+}
+
+static inline vint32m2_t __riscv_vmin_vv_i32m2(vint32m2_t a, vint32m2_t b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] = a.e[k] < b.e[k] ? a.e[k] : b.e[k];
+    return a;
+}
+
+static inline vint32m2_t __riscv_vmin_vx_i32m2(vint32m2_t a, int32_t b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] = a.e[k] < b ? a.e[k] : b;
+    return a;
+}
+
+static inline vint32m2_t __riscv_vand_vx_i32m2(vint32m2_t a, int32_t b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] &= b;
+    return a;
+}
+
+static inline vint32m2_t __riscv_vsra_vx_i32m2(vint32m2_t a, size_t b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] >>= b & 31;
+    return a;
+}
+
+static inline vbool16_t __riscv_vmslt_vv_i32m2_b16(vint32m2_t a, vint32m2_t b, size_t vl)
+{
+    vbool16_t m;
+    RVV_EMU_FOR(k) m.e[k] = a.e[k] < b.e[k];
+    return m;
+}
+
+static inline vbool16_t __riscv_vmseq_vx_i32m2_b16(vint32m2_t a, int32_t b, size_t vl)
+{
+    vbool16_t m;
+    RVV_EMU_FOR(k) m.e[k] = a.e[k] == b;
+    return m;
+}
+
+static inline vbool16_t __riscv_vmsne_vx_i32m2_b16(vint32m2_t a, int32_t b, size_t vl)
+{
+    vbool16_t m;
+    RVV_EMU_FOR(k) m.e[k] = a.e[k] != b;
+    return m;
+}
+
+static inline vbool16_t __riscv_vmand_mm_b16(vbool16_t a, vbool16_t b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] = a.e[k] && b.e[k];
+    return a;
+}
+
+static inline vbool16_t __riscv_vmor_mm_b16(vbool16_t a, vbool16_t b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] = a.e[k] || b.e[k];
+    return a;
+}
+
+// vmerge picks b where the mask is set
+static inline vint32m2_t __riscv_vmerge_vvm_i32m2(vint32m2_t a, vint32m2_t b, vbool16_t m, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] = m.e[k] ? b.e[k] : a.e[k];
+    return a;
+}
+
+static inline vint32m2_t __riscv_vmerge_vxm_i32m2(vint32m2_t a, int32_t b, vbool16_t m, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] = m.e[k] ? b : a.e[k];
+    return a;
+}
+
+static inline vuint32m2_t __riscv_vreinterpret_v_i32m2_u32m2(vint32m2_t a)
+{
+    vuint32m2_t r;
+    memcpy(&r, &a, sizeof(r));
+    return r;
+}
+
+static inline vint32m2_t __riscv_vreinterpret_v_u32m2_i32m2(vuint32m2_t a)
+{
+    vint32m2_t r;
+    memcpy(&r, &a, sizeof(r));
+    return r;
+}
+
+static inline vuint64m4_t __riscv_vreinterpret_v_f64m4_u64m4(vfloat64m4_t a)
+{
+    vuint64m4_t r;
+    memcpy(&r, &a, sizeof(r));
+    return r;
+}
+
+static inline vuint32m2_t __riscv_vnsrl_wx_u32m2(vuint64m4_t a, size_t s, size_t vl)
+{
+    vuint32m2_t r;
+    RVV_EMU_FOR(k) r.e[k] = (uint32_t)(a.e[k] >> (s & 63));
+    return r;
+}
+
+// widening conversions are exact; the narrowing one truncates toward zero (rtz)
+static inline vfloat64m4_t __riscv_vfwcvt_f_x_v_f64m4(vint32m2_t a, size_t vl)
+{
+    vfloat64m4_t r;
+    RVV_EMU_FOR(k) r.e[k] = a.e[k];
+    return r;
+}
+
+static inline vfloat64m4_t __riscv_vfwcvt_f_xu_v_f64m4(vuint32m2_t a, size_t vl)
+{
+    vfloat64m4_t r;
+    RVV_EMU_FOR(k) r.e[k] = a.e[k];
+    return r;
+}
+
+static inline vint32m2_t __riscv_vfncvt_rtz_x_f_w_i32m2(vfloat64m4_t a, size_t vl)
+{
+    vint32m2_t r;
+    RVV_EMU_FOR(k) r.e[k] = (int32_t)a.e[k];
+    return r;
+}
+
+static inline vfloat64m4_t __riscv_vfmul_vf_f64m4(vfloat64m4_t a, double b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] *= b;
+    return a;
+}
+
+static inline vfloat64m4_t __riscv_vfadd_vf_f64m4(vfloat64m4_t a, double b, size_t vl)
+{
+    RVV_EMU_FOR(k) a.e[k] += b;
+    return a;
+}
+
+#endif
@@ -0,0 +1,115 @@
+#include <string.h>
+#include <algorithm>
+#include "hella_mem.h"
+
+#define M_XRD 0 // rocket.MemoryOpConstants
+#define M_XWR 1
+
+HellaMem::HellaMem(const HellaMemConfig &cfg, uint64_t base, size_t size)
+    : cfg_(cfg), base_(base), mem_(size), tags_((size_t)cfg.sets * cfg.ways, ~0ULL), lru_((size_t)cfg.sets * cfg.ways, 0), rng_(cfg.seed)
+{
+}
+
+uint8_t *HellaMem::host(uint64_t addr)
+{
+    if (addr < base_ || addr - base_ >= mem_.size())
+        return nullptr;
+    return &mem_[addr - base_];
+}
+
+bool HellaMem::req_ready() const
+{
+    if (pending_.size() >= (size_t)cfg_.max_inflight)
+        return false;
+    return !accepted_ || now_ - last_accept_ >= (uint64_t)cfg_.req_interval;
+}
+
+void HellaMem::flush()
+{
+    std::fill(tags_.begin(), tags_.end(), ~0ULL);
+}
+
+bool HellaMem::lookup(uint64_t addr)
+{
+    uint64_t line = addr / cfg_.line_bytes;
+    size_t set = (size_t)(line % cfg_.sets) * cfg_.ways, victim = set;
+    for (size_t w = set; w < set + cfg_.ways; ++w)
+    {
+        if (tags_[w] == line)
+        {
+            lru_[w] = now_;
+            return true;
+        }
+        if (lru_[w] < lru_[victim])
+            victim = w;
+    }
+    tags_[victim] = line, lru_[victim] = now_;
+    return false;
+}
+
+void HellaMem::select_resp()
+{
+    resp_ = -1;
+    for (size_t k = 0; k < pending_.size(); ++k)
+    {
+        if (pending_[k].ready > now_)
+        {
+            if (!cfg_.reorder)
+                break; // head-of-line blocking
+            continue;
+        }
+        if (resp_ < 0 || pending_[k].ready < pending_[resp_].ready)
+            resp_ = (long)k;
+    }
+    if (resp_ > 0)
+        ++st_.n_reordered;
+}
+
+void HellaMem::tick(bool req_fire, uint64_t addr, unsigned tag, unsigned cmd, unsigned size, bool is_signed, uint64_t wdata)
+{
+    if (resp_ >= 0) // Valid, not Decoupled: the response is consumed in the cycle it is shown
+    {
+        st_.lat_sum += now_ - pending_[resp_].issue;
+        pending_.erase(pending_.begin() + resp_);
+    }
+    if (!req_ready())
+        ++st_.n_busy;
+    if (req_fire)
+    {
+        Pending r;
+        unsigned bytes = 1u << size;
+        uint8_t *h = host(addr);
+        uint64_t lat;
+
+        r.seq = seq_++, r.issue = now_, r.tag = tag, r.data = 0, r.has_data = (cmd == M_XRD);
+        if (lookup(addr))
+            lat = cfg_.hit_latency, ++st_.n_hit;
+        else
+        {
+            // the refill port serialises misses: a line occupies it for line_bytes/refill_bytes cycles
+            uint64_t start = refill_free_ > now_ ? refill_free_ : now_;
+            refill_free_ = start + (cfg_.line_bytes + cfg_.refill_bytes - 1) / cfg_.refill_bytes;
+            lat = start - now_ + cfg_.miss_latency;
+            if (cfg_.jitter > 0)
+                lat += rng_() % (cfg_.jitter + 1);
+            ++st_.n_miss;
+        }
+        r.ready = now_ + (lat > 0 ? lat : 1);
+        if (h && addr + bytes - base_ <= mem_.size())
+        {
+            if (cmd == M_XWR)
+                memcpy(h, &wdata, bytes), ++st_.n_write;
+            else
+            {
+                memcpy(&r.data, h, bytes);
+                if (is_signed && bytes < 8 && (r.data >> (bytes * 8 - 1) & 1))
+                    r.data |= ~0ULL << (bytes * 8);
+            }
+        }
+        pending_.push_back(r);
+        accepted_ = true, last_accept_ = now_;
+        ++st_.n_req;
+    }
+    ++now_;
+    select_resp();
+}
@@ -0,0 +1,82 @@
+#ifndef HELLA_MEM_H
+#define HELLA_MEM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <random>
+#include <vector>
+
+// Behavioural model of the HellaCacheIO port a RoCC accelerator sees. Timing
+// only, no coherence: a set-associative LRU tag array decides hit or miss,
+// misses share one refill port of limited bandwidth, and responses come back
+// either in issue order or as soon as they are ready (reordering).
+
+struct HellaMemConfig
+{
+    int hit_latency = 2;     // req fire -> resp valid on a hit (Rocket L1D: s2)
+    int miss_latency = 40;   // req fire -> resp valid on a miss, excluding refill queueing
+    int jitter = 0;          // uniform extra [0, jitter] cycles added to every miss
+    int line_bytes = 64;
+    int sets = 64, ways = 4; // 16 KiB default
+    int refill_bytes = 16;   // refill bandwidth in bytes/cycle; one line takes line_bytes/refill_bytes cycles
+    int req_interval = 1;    // accept at most one request every req_interval cycles
+    int max_inflight = 8;    // req_ready drops when this many requests are outstanding
+    bool reorder = false;    // let later hits overtake earlier misses
+    uint32_t seed = 11;
+};
+
+struct HellaMemStats
+{
+    uint64_t n_req = 0, n_hit = 0, n_miss = 0, n_write = 0;
+    uint64_t n_busy = 0;        // cycles req_ready was low
+    uint64_t n_reordered = 0;   // responses returned ahead of an older request
+    uint64_t lat_sum = 0;       // sum of req fire -> resp latencies
+};
+
+class HellaMem
+{
+public:
+    HellaMem(const HellaMemConfig &cfg, uint64_t base, size_t size);
+
+    uint8_t *host(uint64_t addr); // backing store, NULL if out of range
+    uint64_t base() const { return base_; }
+    size_t size() const { return mem_.size(); }
+
+    // Combinational outputs for the current cycle; call before eval()
+    bool req_ready() const;
+    bool resp_valid() const { return resp_ >= 0; }
+    unsigned resp_tag() const { return resp_ >= 0 ? pending_[resp_].tag : 0; }
+    uint64_t resp_data() const { return resp_ >= 0 ? pending_[resp_].data : 0; }
+    bool resp_has_data() const { return resp_ >= 0 && pending_[resp_].has_data; }
+
+    // Latch the request seen at this clock edge and advance one cycle
+    void tick(bool req_fire, uint64_t addr, unsigned tag, unsigned cmd, unsigned size, bool is_signed, uint64_t wdata);
+
+    const HellaMemStats &stats() const { return st_; }
+    void flush(); // invalidate all tags, e.g. between reads of a benchmark
+
+private:
+    struct Pending
+    {
+        uint64_t seq, issue, ready, data;
+        unsigned tag;
+        bool has_data;
+    };
+
+    bool lookup(uint64_t addr); // true on hit; fills the line on a miss
+    void select_resp();
+
+    HellaMemConfig cfg_;
+    uint64_t base_;
+    std::vector<uint8_t> mem_;
+    std::vector<uint64_t> tags_, lru_;
+    std::deque<Pending> pending_;
+    long resp_ = -1; // index into pending_ of the response driven this cycle
+    uint64_t now_ = 0, seq_ = 0, last_accept_ = 0, refill_free_ = 0;
+    bool accepted_ = false;
+    std::mt19937 rng_;
+    HellaMemStats st_;
+};
+
+#endif
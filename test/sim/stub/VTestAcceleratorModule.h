@@ -0,0 +1,177 @@
+#ifndef VTESTACCELERATORMODULE_H
+#define VTESTACCELERATORMODULE_H
+
+// Port-level stand-in for the Verilated TestAcceleratorModule, so that ta_bench
+// and the HellaCache model build and run without Verilator (TA_SIM_STUB). It
+// follows the FSM of TestAccelerator.scala state for state, with its 2-entry
+// command Queue, 32-bit address registers and one memory request in flight,
+// and takes CALONEJ from acc_coj_score(). That is also what ta_bench checks
+// against, so a run here exercises the bench, the handshakes and the memory
+// timing, not the RTL's arithmetic.
+
+#include <stdint.h>
+#include "verilated.h"
+#include "acc_model.h"
+
+class VTestAcceleratorModule
+{
+public:
+    explicit VTestAcceleratorModule(VerilatedContext *ctx) { (void)ctx; }
+
+    // inputs
+    CData clock = 0, reset = 0;
+    CData io_cmd_valid = 0, io_cmd_bits_inst_funct = 0, io_cmd_bits_inst_rd = 0, io_cmd_bits_status_dprv = 0, io_cmd_bits_status_dv = 0;
+    QData io_cmd_bits_rs1 = 0, io_cmd_bits_rs2 = 0;
+    CData io_mem_req_ready = 0, io_mem_resp_valid = 0;
+    SData io_mem_resp_bits_tag = 0;
+    QData io_mem_resp_bits_data = 0;
+    CData io_resp_ready = 0;
+
+    // outputs
+    CData io_cmd_ready = 0, io_mem_req_valid = 0, io_mem_req_bits_cmd = 0, io_mem_req_bits_size = 0, io_mem_req_bits_signed = 0;
+    SData io_mem_req_bits_tag = 0;
+    QData io_mem_req_bits_addr = 0, io_mem_req_bits_data = 0;
+    CData io_resp_valid = 0, io_resp_bits_rd = 0, io_busy = 0, io_interrupt = 0;
+    QData io_resp_bits_data = 0;
+
+    void eval()
+    {
+        if (clock && !clock_last_)
+            posedge();
+        clock_last_ = clock;
+        comb();
+    }
+    void final() {}
+
+private:
+    enum State
+    {
+        IDLE,
+        QSP_READ_REQ_SETUP,
+        QSP_READ_REQ_FIRE,
+        QSP_READ_REQ_RESP,
+        QSP_RET_QSPAN,
+        LPA_READ_REQ_SETUP,
+        LPA_READ_REQ_FIRE,
+        LPA_READ_REQ_RESP,
+        COJ_READ_REQ_SETUP,
+        COJ_READ_REQ_FIRE,
+        COJ_READ_REQ_RESP,
+        COJ_CALCULATION,
+        INST_COMPLETE
+    };
+
+    struct Cmd
+    {
+        CData funct, rd, dprv, dv;
+        QData rs1, rs2;
+    };
+
+    bool req_state() const { return state_ == QSP_READ_REQ_FIRE || state_ == LPA_READ_REQ_FIRE || state_ == COJ_READ_REQ_FIRE; }
+
+    void comb()
+    {
+        const Cmd &h = q_[q_head_];
+        io_cmd_ready = q_n_ < 2;
+        io_mem_req_valid = req_state();
+        io_mem_req_bits_addr = req_addr_, io_mem_req_bits_tag = req_tag_, io_mem_req_bits_cmd = 0; // M_XRD
+        io_mem_req_bits_size = 3, io_mem_req_bits_signed = 1, io_mem_req_bits_data = 0;
+        io_resp_valid = state_ == INST_COMPLETE;
+        io_resp_bits_data = resp_data_, io_resp_bits_rd = h.rd;
+        io_busy = state_ != IDLE, io_interrupt = 0;
+    }
+
+    // every register takes its next value from the values before the edge, as in the Chisel
+    void posedge()
+    {
+        const Cmd h = q_[q_head_];
+        bool q_valid = q_n_ > 0, enq = io_cmd_valid && q_n_ < 2, deq = q_valid && state_ == INST_COMPLETE;
+        bool req_fire = req_state() && io_mem_req_ready, resp = io_mem_resp_valid;
+        uint64_t data = io_mem_resp_bits_data;
+
+        if (reset)
+        {
+            state_ = IDLE, q_n_ = q_head_ = 0, resp_data_ = 0, n_counter_ = n_max_ = sum_qspan_ = 0;
+            base_x_ = params_addr_ = 0, fill_ = 0, idx_j_ = 0, offset_j_ = 0;
+            return;
+        }
+        switch (state_)
+        {
+        case IDLE:
+            if (q_valid && h.funct == ACC_FN_QSPAN)
+            {
+                n_max_ = (uint32_t)h.rs2, n_counter_ = 0, sum_qspan_ = 0;
+                base_x_ = (uint32_t)h.rs1, base_y_ = (uint32_t)(h.rs1 + 8);
+                state_ = QSP_READ_REQ_SETUP;
+            }
+            else if (q_valid && h.funct == ACC_FN_LPARAMS)
+                fill_ = 0, params_addr_ = (uint32_t)h.rs1, state_ = LPA_READ_REQ_SETUP;
+            else if (q_valid && h.funct == ACC_FN_COJ)
+                aj_valid_[0] = aj_valid_[1] = false, idx_j_ = (uint32_t)h.rs1, offset_j_ = 0, state_ = COJ_READ_REQ_SETUP;
+            break;
+        case QSP_READ_REQ_SETUP:
+            if (n_counter_ == n_max_)
+                state_ = QSP_RET_QSPAN;
+            else
+                req_addr_ = base_y_ + (n_counter_ << 4), req_tag_ = n_counter_ & 0xf, state_ = QSP_READ_REQ_FIRE;
+            break;
+        case QSP_READ_REQ_RESP:
+            if (resp)
+                sum_qspan_ += (uint8_t)(data >> 32), ++n_counter_, state_ = QSP_READ_REQ_SETUP;
+            break;
+        case QSP_RET_QSPAN:
+            resp_data_ = sum_qspan_, state_ = INST_COMPLETE;
+            break;
+        case LPA_READ_REQ_SETUP:
+            if (fill_ == ACC_N_PARAMS)
+                state_ = INST_COMPLETE;
+            else
+                req_addr_ = params_addr_ + (fill_ << 3), req_tag_ = fill_ & 0xf, state_ = LPA_READ_REQ_FIRE;
+            break;
+        case LPA_READ_REQ_RESP:
+            if (resp)
+                params_[fill_] = (int64_t)data, fill_ = (fill_ + 1) & 0x1f, state_ = LPA_READ_REQ_SETUP;
+            break;
+        case COJ_READ_REQ_SETUP:
+            if (aj_valid_[0] && aj_valid_[1])
+                state_ = COJ_CALCULATION;
+            else
+                req_addr_ = base_x_ + (idx_j_ << 4) + (offset_j_ << 3), req_tag_ = offset_j_ & 0xf, state_ = COJ_READ_REQ_FIRE;
+            break;
+        case COJ_READ_REQ_RESP:
+            if (resp)
+                aj_valid_[offset_j_] = true, aj_[offset_j_] = data, offset_j_ = (offset_j_ + 1) & 0x1f, state_ = COJ_READ_REQ_SETUP;
+            break;
+        case COJ_CALCULATION:
+            resp_data_ = (uint64_t)acc_coj_score(params_, aj_[0], aj_[1]), state_ = INST_COMPLETE;
+            break;
+        case INST_COMPLETE:
+            state_ = IDLE;
+            break;
+        default: // the *_READ_REQ_FIRE states
+            if (req_fire)
+                state_ = (State)(state_ + 1);
+            break;
+        }
+        if (deq)
+            q_head_ ^= 1, --q_n_;
+        if (enq)
+        {
+            Cmd &c = q_[(q_head_ + q_n_) & 1];
+            c.funct = io_cmd_bits_inst_funct, c.rd = io_cmd_bits_inst_rd, c.dprv = io_cmd_bits_status_dprv, c.dv = io_cmd_bits_status_dv;
+            c.rs1 = io_cmd_bits_rs1, c.rs2 = io_cmd_bits_rs2;
+            ++q_n_;
+        }
+    }
+
+    State state_ = IDLE;
+    Cmd q_[2] = {};
+    int q_n_ = 0, q_head_ = 0;
+    bool clock_last_ = false, aj_valid_[2] = {false, false};
+    uint32_t req_addr_ = 0, req_tag_ = 0, base_x_ = 0, base_y_ = 0, params_addr_ = 0, n_counter_ = 0, n_max_ = 0, sum_qspan_ = 0;
+    uint32_t fill_ = 0, idx_j_ = 0, offset_j_ = 0;
+    uint64_t resp_data_ = 0, aj_[2] = {0, 0};
+    int64_t params_[ACC_N_PARAMS] = {};
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef VERILATED_H
+#define VERILATED_H
+
+// The part of Verilator's runtime header that ta_bench uses, for the
+// TA_SIM_STUB build against stub/VTestAcceleratorModule.h.
+
+#include <stdint.h>
+
+typedef uint8_t CData;
+typedef uint16_t SData;
+typedef uint32_t IData;
+typedef uint64_t QData;
+
+class VerilatedContext
+{
+public:
+    void commandArgs(int argc, char **argv) { (void)argc, (void)argv; }
+};
+
+#endif
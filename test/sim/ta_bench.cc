@@ -0,0 +1,319 @@
+// Cycle benchmark for TestAcceleratorModule under Verilator.
+//
+// Drives the RoCC command port the way acc_indp_chain.c does (QSPAN once per
+// read, then LOAD_PARAMS per anchor i and CALONEJ per scored predecessor j),
+// answers io.mem from a behavioural HellaCache model and checks every
+// response against acc_model.h: the QSPAN sum, and acc_coj_score(), the model
+// of the CALONEJ datapath as built, for every predecessor.
+//
+// usage: ta_bench [options] anchors.txt
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <vector>
+
+#include "verilated.h"
+#include "VTestAcceleratorModule.h"
+#include "hella_mem.h"
+#include "anchors.h"
+#include "mmpriv.h"
+#include "acc_model.h"
+
+enum
+{
+    FN_QSPAN = 0,
+    FN_LPARAMS = 1,
+    FN_COJ = 2,
+    FN_N
+};
+
+static const char *fn_name[FN_N] = {"QSPAN", "LPARAMS", "CALONEJ"};
+
+struct CmdStats
+{
+    uint64_t n = 0, cyc = 0, min = UINT64_MAX, max = 0;
+    void add(uint64_t c)
+    {
+        ++n, cyc += c;
+        min = c < min ? c : min, max = c > max ? c : max;
+    }
+};
+
+struct ChainOpt
+{
+    int max_dist_x = 5000, max_skip = 25, max_iter = 5000, is_cdna = 0;
+    float gap_scale = 1.0f;
+};
+
+class Bench
+{
+public:
+    Bench(VerilatedContext *ctx, HellaMem *mem, uint64_t timeout) : top_(new VTestAcceleratorModule(ctx)), mem_(mem), timeout_(timeout)
+    {
+        top_->io_resp_ready = 1;
+        top_->io_cmd_valid = 0;
+        top_->reset = 1;
+        for (int k = 0; k < 10; ++k)
+            step();
+        top_->reset = 0;
+        cycle_ = 0;
+    }
+    ~Bench()
+    {
+        top_->final();
+        delete top_;
+    }
+
+    uint64_t cycle() const { return cycle_; }
+
+    // Issue one command and block until its response, like the driver does after a fence
+    uint64_t issue(unsigned funct, uint64_t rs1, uint64_t rs2, CmdStats *st)
+    {
+        uint64_t t0 = cycle_;
+        cmd_valid_ = true, got_resp_ = false;
+        top_->io_cmd_bits_inst_funct = funct;
+        top_->io_cmd_bits_inst_rd = 10;
+        top_->io_cmd_bits_rs1 = rs1;
+        top_->io_cmd_bits_rs2 = rs2;
+        top_->io_cmd_bits_status_dprv = 3;
+        top_->io_cmd_bits_status_dv = 0;
+        while (!got_resp_)
+        {
+            if (cycle_ - t0 > timeout_)
+            {
+                fprintf(stderr, "[E::%s] %s timed out after %" PRIu64 " cycles\n", __func__, fn_name[funct], timeout_);
+                exit(1);
+            }
+            step();
+        }
+        st[funct].add(cycle_ - t0);
+        return resp_data_;
+    }
+
+private:
+    void step()
+    {
+        bool cmd_fire, req_fire;
+        uint64_t addr = 0, wdata = 0;
+        unsigned tag = 0, cmd = 0, size = 0, sgn = 0;
+
+        top_->io_cmd_valid = cmd_valid_;
+        top_->io_mem_req_ready = mem_->req_ready();
+        top_->io_mem_resp_valid = mem_->resp_valid();
+        top_->io_mem_resp_bits_tag = mem_->resp_tag();
+        top_->io_mem_resp_bits_data = mem_->resp_data();
+        top_->clock = 0;
+        top_->eval();
+
+        cmd_fire = cmd_valid_ && top_->io_cmd_ready;
+        req_fire = top_->io_mem_req_valid && top_->io_mem_req_ready;
+        if (req_fire)
+        {
+            addr = top_->io_mem_req_bits_addr, tag = top_->io_mem_req_bits_tag;
+            cmd = top_->io_mem_req_bits_cmd, size = top_->io_mem_req_bits_size;
+            sgn = top_->io_mem_req_bits_signed, wdata = top_->io_mem_req_bits_data;
+        }
+        if (top_->io_resp_valid && !top_->reset)
+            got_resp_ = true, resp_data_ = top_->io_resp_bits_data;
+
+        top_->clock = 1;
+        top_->eval();
+        mem_->tick(req_fire, addr, tag, cmd, size, sgn, wdata);
+        if (cmd_fire)
+            cmd_valid_ = false;
+        ++cycle_;
+    }
+
+    VTestAcceleratorModule *top_;
+    HellaMem *mem_;
+    uint64_t timeout_, cycle_ = 0, resp_data_ = 0;
+    bool cmd_valid_ = false, got_resp_ = false;
+};
+
+struct ReadResult
+{
+    uint64_t cycles = 0, n_pred = 0, n_err = 0;
+};
+
+static ReadResult run_read(Bench &b, HellaMem &mem, const mm_anchors1_t *r, const ChainOpt &o, CmdStats *st, int max_print)
+{
+    const uint64_t param_addr = mem.base() + 0x100, a_addr = mem.base() + 0x1000;
+    int64_t i, j, st_i = 0, n = r->n;
+    uint64_t sum_ref = 0, sum_hw, t0 = b.cycle();
+    std::vector<int32_t> f(n), p(n), t(n, 0);
+    int64_t q32_avg_qspan, q32_gap_scale = acc_q32_from_float(o.gap_scale);
+    ReadResult rr;
+
+    memcpy(mem.host(a_addr), r->a, n * sizeof(mm128_t));
+    for (i = 0; i < n; ++i)
+        sum_ref += r->a[i].y >> 32 & 0xff;
+    sum_hw = b.issue(FN_QSPAN, a_addr, n, st);
+    if ((uint32_t)sum_hw != (uint32_t)sum_ref && rr.n_err++ < (uint64_t)max_print)
+        printf("MISMATCH\t%s\tQSPAN\thw=%" PRIu64 "\tref=%" PRIu64 "\n", r->name, sum_hw, sum_ref);
+    q32_avg_qspan = acc_q32_avg(sum_ref, n); // as mm_chain_fill_acc_init() loads it
+
+    for (i = 0; i < n; ++i)
+    {
+        uint64_t ri = r->a[i].x;
+        int64_t max_j = -1;
+        int32_t qi = (int32_t)r->a[i].y, q_span = r->a[i].y >> 32 & 0xff;
+        int32_t max_f = q_span, n_skip = 0;
+        int32_t sidi = (r->a[i].y & MM_SEED_SEG_MASK) >> MM_SEED_SEG_SHIFT;
+        int64_t params[ACC_N_PARAMS] = {o.is_cdna, (int64_t)ri, qi, q_span, sidi, q32_avg_qspan, q32_gap_scale};
+
+        while (st_i < i && ri > r->a[st_i].x + o.max_dist_x)
+            ++st_i;
+        if (i - st_i > o.max_iter)
+            st_i = i - o.max_iter;
+        memcpy(mem.host(param_addr), params, sizeof(params));
+        b.issue(FN_LPARAMS, param_addr, 0, st);
+        for (j = i - 1; j >= st_i; --j)
+        {
+            int64_t ref = acc_coj_score(params, r->a[j].x, r->a[j].y), hw = (int64_t)b.issue(FN_COJ, j, 0, st);
+            int32_t sc = (int32_t)ref;
+            ++rr.n_pred;
+            if (hw != ref && rr.n_err++ < (uint64_t)max_print)
+                printf("MISMATCH\t%s\tCALONEJ\ti=%" PRId64 "\tj=%" PRId64 "\thw=%" PRId64 "\tref=%" PRId64 "\n", r->name, i, j, hw, ref);
+            sc += f[j];
+            if (sc > max_f)
+            {
+                max_f = sc, max_j = j;
+                if (n_skip > 0)
+                    --n_skip;
+            }
+            else if (t[j] == i)
+            {
+                if (++n_skip > o.max_skip)
+                    break;
+            }
+            if (p[j] >= 0)
+                t[p[j]] = i;
+        }
+        f[i] = max_f, p[i] = max_j;
+    }
+    rr.cycles = b.cycle() - t0;
+    return rr;
+}
+
+static void usage(FILE *fp, const HellaMemConfig &m, const ChainOpt &o)
+{
+    fprintf(fp, "Usage: ta_bench [options] <anchors.txt>\n");
+    fprintf(fp, "Chaining:\n");
+    fprintf(fp, "  -x INT     max_dist_x [%d]\n", o.max_dist_x);
+    fprintf(fp, "  -s INT     max_skip [%d]\n", o.max_skip);
+    fprintf(fp, "  -i INT     max_iter [%d]\n", o.max_iter);
+    fprintf(fp, "  -g FLOAT   gap_scale [%g]\n", o.gap_scale);
+    fprintf(fp, "  -c         is_cdna\n");
+    fprintf(fp, "Memory model:\n");
+    fprintf(fp, "  -H INT     hit latency [%d]\n", m.hit_latency);
+    fprintf(fp, "  -M INT     miss latency [%d]\n", m.miss_latency);
+    fprintf(fp, "  -J INT     max random extra cycles per miss [%d]\n", m.jitter);
+    fprintf(fp, "  -S INT     cache sets [%d]\n", m.sets);
+    fprintf(fp, "  -W INT     cache ways [%d]\n", m.ways);
+    fprintf(fp, "  -L INT     line bytes [%d]\n", m.line_bytes);
+    fprintf(fp, "  -B INT     refill bandwidth in bytes/cycle [%d]\n", m.refill_bytes);
+    fprintf(fp, "  -I INT     accept one request every INT cycles [%d]\n", m.req_interval);
+    fprintf(fp, "  -O INT     max outstanding requests [%d]\n", m.max_inflight);
+    fprintf(fp, "  -R         allow out-of-order responses\n");
+    fprintf(fp, "  -C         flush the cache before every read\n");
+    fprintf(fp, "Misc:\n");
+    fprintf(fp, "  -n INT     process at most INT reads [all]\n");
+    fprintf(fp, "  -e INT     print at most INT mismatches per read [10]\n");
+    fprintf(fp, "  -T INT     per-command timeout in cycles [1000000]\n");
+}
+
+int main(int argc, char *argv[])
+{
+    HellaMemConfig mc;
+    ChainOpt o;
+    mm_anchors_t as;
+    CmdStats st[FN_N];
+    int c, cold = 0, max_print = 10, n_reads = -1, k;
+    uint64_t timeout = 1000000, tot_cyc = 0, tot_anchors = 0, tot_pred = 0, tot_err = 0, max_n = 0;
+
+    while ((c = getopt(argc, argv, "x:s:i:g:cH:M:J:S:W:L:B:I:O:RCn:e:T:h")) >= 0)
+    {
+        if (c == 'x') o.max_dist_x = atoi(optarg);
+        else if (c == 's') o.max_skip = atoi(optarg);
+        else if (c == 'i') o.max_iter = atoi(optarg);
+        else if (c == 'g') o.gap_scale = atof(optarg);
+        else if (c == 'c') o.is_cdna = 1;
+        else if (c == 'H') mc.hit_latency = atoi(optarg);
+        else if (c == 'M') mc.miss_latency = atoi(optarg);
+        else if (c == 'J') mc.jitter = atoi(optarg);
+        else if (c == 'S') mc.sets = atoi(optarg);
+        else if (c == 'W') mc.ways = atoi(optarg);
+        else if (c == 'L') mc.line_bytes = atoi(optarg);
+        else if (c == 'B') mc.refill_bytes = atoi(optarg);
+        else if (c == 'I') mc.req_interval = atoi(optarg);
+        else if (c == 'O') mc.max_inflight = atoi(optarg);
+        else if (c == 'R') mc.reorder = true;
+        else if (c == 'C') cold = 1;
+        else if (c == 'n') n_reads = atoi(optarg);
+        else if (c == 'e') max_print = atoi(optarg);
+        else if (c == 'T') timeout = strtoull(optarg, 0, 10);
+        else if (c == 'h')
+        {
+            usage(stdout, mc, o);
+            return 0;
+        }
+        else
+        {
+            usage(stderr, mc, o);
+            return 1;
+        }
+    }
+    if (optind == argc)
+    {
+        usage(stderr, mc, o);
+        return 1;
+    }
+    if (mm_anchors_read(argv[optind], &as) < 0)
+    {
+        fprintf(stderr, "[E::%s] failed to read anchors from '%s'\n", __func__, argv[optind]);
+        return 1;
+    }
+    if (n_reads >= 0 && n_reads < as.n)
+        as.n = n_reads;
+    for (k = 0; k < as.n; ++k)
+        max_n = (uint64_t)as.r[k].n > max_n ? as.r[k].n : max_n;
+
+    VerilatedContext ctx;
+    ctx.commandArgs(argc, argv);
+    // the accelerator drives 32-bit addresses, so the whole arena must sit below 4 GiB
+    HellaMem mem(mc, 0x80000000ULL, 0x1000 + max_n * sizeof(mm128_t));
+    Bench b(&ctx, &mem, timeout);
+
+    printf("#read\tn\tpreds\tcycles\tcyc/anchor\tcyc/pred\tmismatches\n");
+    for (k = 0; k < as.n; ++k)
+    {
+        const mm_anchors1_t *r = &as.r[k];
+        ReadResult rr;
+        if (r->n == 0)
+            continue;
+        if (cold)
+            mem.flush();
+        rr = run_read(b, mem, r, o, st, max_print);
+        printf("%s\t%" PRId64 "\t%" PRIu64 "\t%" PRIu64 "\t%.2f\t%.2f\t%" PRIu64 "\n", r->name, r->n, rr.n_pred, rr.cycles,
+               (double)rr.cycles / r->n, rr.n_pred ? (double)rr.cycles / rr.n_pred : 0.0, rr.n_err);
+        tot_cyc += rr.cycles, tot_anchors += r->n, tot_pred += rr.n_pred, tot_err += rr.n_err;
+    }
+
+    const HellaMemStats &ms = mem.stats();
+    printf("\n#command\tcount\tcycles\tavg\tmin\tmax\n");
+    for (k = 0; k < FN_N; ++k)
+        printf("%s\t%" PRIu64 "\t%" PRIu64 "\t%.2f\t%" PRIu64 "\t%" PRIu64 "\n", fn_name[k], st[k].n, st[k].cyc,
+               st[k].n ? (double)st[k].cyc / st[k].n : 0.0, st[k].n ? st[k].min : 0, st[k].max);
+    printf("\n#memory\treqs\thits\tmisses\treordered\tbusy_cycles\tavg_latency\n");
+    printf("mem\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%.2f\n", ms.n_req, ms.n_hit, ms.n_miss, ms.n_reordered,
+           ms.n_busy, ms.n_req ? (double)ms.lat_sum / ms.n_req : 0.0);
+    printf("\n#total\tanchors\tpreds\tcycles\tcyc/anchor\tcyc/pred\tmismatches\n");
+    printf("total\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%.2f\t%.2f\t%" PRIu64 "\n", tot_anchors, tot_pred, tot_cyc,
+           tot_anchors ? (double)tot_cyc / tot_anchors : 0.0, tot_pred ? (double)tot_cyc / tot_pred : 0.0, tot_err);
+
+    mm_anchors_destroy(&as);
+    return tot_err ? 2 : 0;
+}
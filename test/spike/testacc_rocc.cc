@@ -0,0 +1,73 @@
+// Spike extension implementing the TestAccelerator custom0 instructions.
+//
+// The datapath is acc_model.h, the same bit-exact model the host emulation
+// uses; loads go through Spike's MMU so translation and faults behave as for
+// the real RoCC unit. Statistics are printed to stderr when Spike exits.
+//
+// usage: spike --extlib=libtestacc.so --extension=testacc acc_indp_chain.riscv
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <riscv/extension.h>
+#include <riscv/mmu.h>
+#include <riscv/processor.h>
+#include <riscv/rocc.h>
+#include <riscv/trap.h>
+
+#include "../acc_model.h"
+
+static const char *fn_name[ACC_N_FN] = {"QSPAN", "LPARAMS", "CALONEJ"};
+
+class testacc_rocc_t : public rocc_t
+{
+public:
+    testacc_rocc_t()
+    {
+        // FSM timing for an L1 hit, matching rocc_emu.c
+        cfg_.mem_latency = 2, cfg_.issue_cycles = 2;
+        acc_state_init(&state_, 0xffffffffULL); // the accelerator's address registers are 32 bits wide
+    }
+
+    ~testacc_rocc_t()
+    {
+        uint64_t n = 0;
+        for (int k = 0; k < ACC_N_FN; ++k)
+        {
+            fprintf(stderr, "[testacc] %-8s commands=%" PRIu64 " cycles=%" PRIu64 "\n", fn_name[k], stats_.n_cmd[k], stats_.cycles[k]);
+            n += stats_.n_cmd[k];
+        }
+        fprintf(stderr, "[testacc] total    commands=%" PRIu64 " loads=%" PRIu64 " bytes=%" PRIu64 " stall_cycles=%" PRIu64 "\n", n, stats_.n_load,
+                stats_.bytes, stats_.stall);
+    }
+
+    const char *name() { return "testacc"; }
+
+#ifdef SPIKE_ROCC_PROC_ARG // riscv-isa-sim after the processor_t* argument was added to rocc_t
+    reg_t custom0(processor_t *proc, rocc_insn_t insn, reg_t xs1, reg_t xs2) { return exec(proc, insn, xs1, xs2); }
+#else
+    reg_t custom0(rocc_insn_t insn, reg_t xs1, reg_t xs2) { return exec(p, insn, xs1, xs2); }
+#endif
+
+    void reset() { acc_state_init(&state_, 0xffffffffULL); }
+
+private:
+    static uint64_t load64(void *data, uint64_t addr)
+    {
+        return ((processor_t *)data)->get_mmu()->load<uint64_t>(addr);
+    }
+
+    reg_t exec(processor_t *proc, rocc_insn_t insn, reg_t xs1, reg_t xs2)
+    {
+        int err;
+        reg_t rd = acc_exec(&state_, &stats_, &cfg_, insn.funct, xs1, xs2, load64, proc, &err);
+        if (err)
+            throw trap_illegal_instruction(0); // unimplemented funct
+        return rd;
+    }
+
+    acc_cfg_t cfg_;
+    acc_state_t state_;
+    acc_stats_t stats_ = {};
+};
+
+REGISTER_EXTENSION(testacc, []() { return new testacc_rocc_t; })
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include "chain_trace.h"
+
+static const char *ev_name(uint32_t ev)
+{
+    if (ev == MM_TRACE_CALL) return "CALL";
+    else if (ev == MM_TRACE_PAIR) return "PAIR";
+    else if (ev == MM_TRACE_COJ) return "COJ";
+    else if (ev == MM_TRACE_ROW) return "ROW";
+    return "?";
+}
+
+static void usage(FILE *fp)
+{
+    fprintf(fp, "Usage: trace_decode [options] <trace.mmt>\n");
+    fprintf(fp, "  -e STR     only events of this type (CALL, PAIR, COJ, ROW)\n");
+    fprintf(fp, "  -i INT     only events of row i\n");
+}
+
+int main(int argc, char *argv[])
+{
+    mm_trace_fhdr_t fh;
+    mm_trace_rec_t r;
+    FILE *fp;
+    int c, sel_ev = 0;
+    int64_t sel_i = -1;
+    uint64_t k;
+
+    while ((c = getopt(argc, argv, "e:i:h")) >= 0)
+    {
+        if (c == 'e')
+        {
+            for (sel_ev = MM_TRACE_ROW; sel_ev > 0; --sel_ev)
+                if (strcmp(optarg, ev_name(sel_ev)) == 0)
+                    break;
+            if (sel_ev == 0)
+            {
+                fprintf(stderr, "[E::%s] unknown event type '%s'\n", __func__, optarg);
+                return 1;
+            }
+        }
+        else if (c == 'i') sel_i = atol(optarg);
+        else if (c == 'h')
+        {
+            usage(stdout);
+            return 0;
+        }
+        else
+        {
+            usage(stderr);
+            return 1;
+        }
+    }
+    if (optind == argc)
+    {
+        usage(stderr);
+        return 1;
+    }
+    if ((fp = fopen(argv[optind], "rb")) == 0)
+    {
+        fprintf(stderr, "[E::%s] failed to open '%s'\n", __func__, argv[optind]);
+        return 1;
+    }
+    if (fread(&fh, sizeof(fh), 1, fp) != 1 || memcmp(fh.magic, MM_TRACE_MAGIC, 4) != 0 || fh.rec_size != sizeof(mm_trace_rec_t))
+    {
+        fprintf(stderr, "[E::%s] '%s' is not a trace file of this build\n", __func__, argv[optind]);
+        fclose(fp);
+        return 1;
+    }
+    if (fh.n_total > fh.n_kept)
+        printf("# %" PRIu64 " of %" PRIu64 " events; the oldest were overwritten\n", fh.n_kept, fh.n_total);
+    printf("#event\ti\tj\tdr\tdq\tsc\tgap_cost\tmax_j\n");
+    for (k = 0; k < fh.n_kept && fread(&r, sizeof(r), 1, fp) == 1; ++k)
+    {
+        if ((sel_ev && r.ev != (uint32_t)sel_ev) || (sel_i >= 0 && r.i != sel_i))
+            continue;
+        printf("%s\t%" PRId64 "\t%" PRId64 "\t%" PRId64 "\t%d\t%d\t%d\t%" PRId64 "\n", ev_name(r.ev), r.i, r.j, r.dr, r.dq, r.sc, r.gap_cost,
+               r.max_j);
+    }
+    if (k < fh.n_kept)
+        fprintf(stderr, "[W::%s] truncated trace: %" PRIu64 " of %" PRIu64 " records\n", __func__, k, fh.n_kept);
+    fclose(fp);
+    return 0;
+}